@@ -0,0 +1,259 @@
+/*
+ * File: autotune.c
+ * Author: Domenic Murtari
+ * Project: CSCI 3753 Programming Assignment 2
+ * Description: Finds good pipeline parameters by running short trial passes
+ *  over a sample of the input. The search is coordinate descent: sweep the
+ *  resolver thread count with the other values fixed, then the queue size,
+ *  then the batch size, keeping the best value of each before moving on. This
+ *  takes a couple dozen trials instead of the full cross product.
+ *
+ */
+
+#include "autotune.h"
+#include "fileio.h"
+
+/* Candidate values for the queue and batch sweeps. Thread counts are swept
+ * over 2, 3, 4, 6, 8, 12, ... up to the configured maximum */
+static const int queueSizes[] = {2, 5, 10, 20, 50};
+static const int batchSizes[] = {1, 2, 4, 8, 16};
+
+#define COUNT(a) ((int)(sizeof(a) / sizeof((a)[0])))
+
+/*
+ * Copies up to sampleSize names from the front of inputFile into a new
+ * temporary file whose path is written to samplePath.
+ */
+static int write_sample(const char* inputFile, int sampleSize,
+                        char* samplePath, size_t pathSize){
+
+  fileio_reader input;
+  FILE* samplefp;
+  char hostname[MAX_NAME_LENGTH];
+  const char* tmpdir;
+  int fd;
+  int i;
+
+  tmpdir = getenv("TMPDIR");
+  if(!tmpdir)
+    tmpdir = "/tmp";
+  snprintf(samplePath, pathSize, "%s/multi-lookup-sample-XXXXXX", tmpdir);
+
+  if(fileio_reader_open(&input, inputFile) == FILEIO_FAILURE){
+    perror("Error Opening Input File");
+    return UTIL_FAILURE;
+  }
+  if((fd = mkstemp(samplePath)) < 0){
+    perror("Error Creating Sample File");
+    fileio_reader_close(&input);
+    return UTIL_FAILURE;
+  }
+  if(!(samplefp = fdopen(fd, "w"))){
+    perror("Error Creating Sample File");
+    close(fd);
+    unlink(samplePath);
+    fileio_reader_close(&input);
+    return UTIL_FAILURE;
+  }
+
+  for(i = 0; i < sampleSize &&
+        fileio_read_name(&input, hostname, sizeof(hostname)) > 0; i++)
+    fprintf(samplefp, "%s\n", hostname);
+
+  fclose(samplefp);
+  fileio_reader_close(&input);
+  return UTIL_SUCCESS;
+}
+
+/*
+ * Runs AUTOTUNE_REPEATS trial passes with the given parameters and returns
+ * the fastest elapsed time, or -1 if a pass failed.
+ */
+static long trial(const struct lookup_config* config,
+                  struct lookup_source* samples, int sampleCount){
+
+  FILE* devnull;
+  long best = -1;
+  long elapsed;
+  int i;
+
+  devnull = fopen("/dev/null", "w");
+  if(!devnull){
+    perror("Error Opening /dev/null");
+    return -1;
+  }
+
+  for(i = 0; i < AUTOTUNE_REPEATS; i++){
+    elapsed = run_pipeline(config, samples, sampleCount, devnull);
+    if(elapsed < 0){
+      best = -1;
+      break;
+    }
+    if(best < 0 || elapsed < best)
+      best = elapsed;
+  }
+
+  fclose(devnull);
+  fprintf(stderr, "autotune: queue=%d threads=%d batch=%d -> %ld us\n",
+          config->queueSize, config->resolverThreads, config->batchSize, best);
+  return best;
+}
+
+/*
+ * Tries each candidate for one parameter, leaving the fastest in *param.
+ */
+static int sweep(struct lookup_config* config, int* param,
+                 const int* candidates, int count,
+                 struct lookup_source* samples, int sampleCount){
+
+  int bestValue = *param;
+  long bestTime = -1;
+  long elapsed;
+  int i;
+
+  for(i = 0; i < count; i++){
+    *param = candidates[i];
+    if((elapsed = trial(config, samples, sampleCount)) < 0)
+      return UTIL_FAILURE;
+    if(bestTime < 0 || elapsed < bestTime){
+      bestTime = elapsed;
+      bestValue = candidates[i];
+    }
+  }
+
+  *param = bestValue;
+  return UTIL_SUCCESS;
+}
+
+int autotune(struct lookup_config* config, char** inputFiles, int inputCount,
+             int sampleSize){
+
+  char paths[inputCount][SBUFSIZE];
+  struct lookup_source samples[inputCount];
+  int threadCounts[64];
+  int threadCount = 0;
+  int created = 0;
+  int ret = UTIL_FAILURE;
+  int i;
+
+  /* Build the thread count candidates: powers of two and the points halfway
+   * between them, then the maximum itself */
+  for(i = MIN_RESOLVER_THREADS; i <= config->maxResolverThreads; i *= 2){
+    threadCounts[threadCount++] = i;
+    if(i * 3 / 2 <= config->maxResolverThreads)
+      threadCounts[threadCount++] = i * 3 / 2;
+  }
+  if(threadCount == 0 ||
+     threadCounts[threadCount - 1] < config->maxResolverThreads)
+    threadCounts[threadCount++] = config->maxResolverThreads;
+
+  /* Take a sample from each input file so every requester still runs */
+  for(created = 0; created < inputCount; created++){
+    samples[created].path = paths[created];
+    samples[created].table = NULL;
+    samples[created].shard = 0;
+    samples[created].priority = 0;
+    samples[created].weight = 1;
+    if(write_sample(inputFiles[created], sampleSize, paths[created],
+                    sizeof(paths[created])) == UTIL_FAILURE)
+      goto cleanup;
+  }
+
+  if(sweep(config, &config->resolverThreads, threadCounts, threadCount,
+           samples, inputCount) == UTIL_FAILURE)
+    goto cleanup;
+  if(sweep(config, &config->queueSize, queueSizes, COUNT(queueSizes),
+           samples, inputCount) == UTIL_FAILURE)
+    goto cleanup;
+  if(sweep(config, &config->batchSize, batchSizes, COUNT(batchSizes),
+           samples, inputCount) == UTIL_FAILURE)
+    goto cleanup;
+
+  fprintf(stderr, "autotune: best queue=%d threads=%d batch=%d\n",
+          config->queueSize, config->resolverThreads, config->batchSize);
+  ret = UTIL_SUCCESS;
+
+ cleanup:
+  for(i = 0; i < created; i++)
+    unlink(paths[i]);
+  return ret;
+}
+
+int profile_load(const char* path, struct lookup_config* config){
+
+  FILE* profilefp;
+  char line[SBUFSIZE];
+  char key[SBUFSIZE];
+  int value;
+  int lineNumber = 0;
+  int batchSize = config->batchSize;
+  int queueSize = config->queueSize;
+  int maxResolverThreads = config->maxResolverThreads;
+
+  profilefp = fopen(path, "r");
+  if(!profilefp)
+    return UTIL_SUCCESS;
+
+  while(fgets(line, sizeof(line), profilefp)){
+    lineNumber++;
+    if(line[0] == '#' || line[0] == '\n')
+      continue;
+    if(sscanf(line, " %1024[^= ] = %d", key, &value) != 2 || value <= 0){
+      fprintf(stderr, "%s:%d: malformed profile line\n", path, lineNumber);
+      fclose(profilefp);
+      return UTIL_FAILURE;
+    }
+    if(!strcmp(key, "queue_size"))
+      queueSize = value;
+    else if(!strcmp(key, "resolver_threads"))
+      config->resolverThreads = value;
+    else if(!strcmp(key, "max_resolver_threads"))
+      maxResolverThreads = value;
+    else if(!strcmp(key, "batch_size"))
+      batchSize = value;
+    else
+      fprintf(stderr, "%s:%d: unknown setting %s\n", path, lineNumber, key);
+  }
+
+  fclose(profilefp);
+
+  if(batchSize > MAX_BATCH_SIZE){
+    fprintf(stderr, "%s: batch_size %d exceeds maximum of %d\n", path,
+            batchSize, MAX_BATCH_SIZE);
+    return UTIL_FAILURE;
+  }
+  if(queueSize > MAX_QUEUE_SIZE){
+    fprintf(stderr, "%s: queue_size %d exceeds maximum of %d\n", path,
+            queueSize, MAX_QUEUE_SIZE);
+    return UTIL_FAILURE;
+  }
+  if(maxResolverThreads > RESOLVER_THREAD_LIMIT){
+    fprintf(stderr, "%s: max_resolver_threads %d exceeds maximum of %d\n",
+            path, maxResolverThreads, RESOLVER_THREAD_LIMIT);
+    return UTIL_FAILURE;
+  }
+  config->batchSize = batchSize;
+  config->queueSize = queueSize;
+  config->maxResolverThreads = maxResolverThreads;
+  return UTIL_SUCCESS;
+}
+
+int profile_save(const char* path, const struct lookup_config* config){
+
+  FILE* profilefp;
+
+  profilefp = fopen(path, "w");
+  if(!profilefp){
+    perror("Error Opening Profile");
+    return UTIL_FAILURE;
+  }
+
+  fprintf(profilefp, "# multi-lookup tuning profile, written by --autotune\n");
+  fprintf(profilefp, "queue_size=%d\n", config->queueSize);
+  fprintf(profilefp, "resolver_threads=%d\n", config->resolverThreads);
+  fprintf(profilefp, "max_resolver_threads=%d\n", config->maxResolverThreads);
+  fprintf(profilefp, "batch_size=%d\n", config->batchSize);
+
+  fclose(profilefp);
+  return UTIL_SUCCESS;
+}
@@ -0,0 +1,33 @@
+/*
+ * File: autotune.h
+ * Author: Domenic Murtari
+ * Project: CSCI 3753 Programming Assignment 2
+ * Description: Declarations for the pipeline autotuner and the tuning profile
+ *  that it saves between runs.
+ *
+ */
+
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+#include "multi-lookup.h"
+
+/* Names taken from the front of each input file for trial passes */
+#define AUTOTUNE_SAMPLE 50
+/* Trial passes per candidate; the fastest one counts */
+#define AUTOTUNE_REPEATS 3
+
+/* Searches queue size, resolver thread count and batch size for the fastest
+ * pipeline on a sample of the input files, storing the winner in config.
+ * Returns UTIL_SUCCESS, or UTIL_FAILURE if the trials could not be run */
+int autotune(struct lookup_config* config, char** inputFiles, int inputCount,
+             int sampleSize);
+
+/* Reads key=value settings from a profile into config. A missing file is not
+ * an error. Returns UTIL_FAILURE only if the file exists but is malformed */
+int profile_load(const char* path, struct lookup_config* config);
+
+/* Writes the tuned settings in config to a profile */
+int profile_save(const char* path, const struct lookup_config* config);
+
+#endif
@@ -0,0 +1,187 @@
+/*
+ * File: decompress.c
+ * Author: Domenic Murtari
+ * Project: CSCI 3753 Programming Assignment 2
+ * Description: gzip and zstd stream decoders behind one interface, so the
+ *  reader does not need to know which library is in use.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "decompress.h"
+
+int decompress_detect(const char* data, size_t len){
+
+  const unsigned char* p = (const unsigned char*)data;
+
+  if(len >= 2 && p[0] == 0x1f && p[1] == 0x8b)
+    return DECOMPRESS_GZIP;
+  if(len >= 4 && p[0] == 0x28 && p[1] == 0xb5 && p[2] == 0x2f && p[3] == 0xfd)
+    return DECOMPRESS_ZSTD;
+  return DECOMPRESS_NONE;
+}
+
+const char* decompress_name(int format){
+
+  switch(format){
+  case DECOMPRESS_GZIP:
+    return "gzip";
+  case DECOMPRESS_ZSTD:
+    return "zstd";
+  default:
+    return "none";
+  }
+}
+
+int decompress_init(decompressor* d, int format){
+
+  z_stream* z;
+
+  memset(d, 0, sizeof(*d));
+  d->format = format;
+
+  if(format == DECOMPRESS_GZIP){
+    if(!(z = calloc(1, sizeof(*z))))
+      return DECOMPRESS_FAILURE;
+    /* 15 + 32: largest window, and accept a gzip or zlib header */
+    if(inflateInit2(z, 15 + 32) != Z_OK){
+      free(z);
+      errno = ENOMEM;
+      return DECOMPRESS_FAILURE;
+    }
+    d->stream = z;
+    return DECOMPRESS_SUCCESS;
+  }
+
+#ifdef HAVE_ZSTD
+  if(format == DECOMPRESS_ZSTD){
+    if(!(d->stream = ZSTD_createDStream())){
+      errno = ENOMEM;
+      return DECOMPRESS_FAILURE;
+    }
+    ZSTD_initDStream(d->stream);
+    return DECOMPRESS_SUCCESS;
+  }
+#else
+  if(format == DECOMPRESS_ZSTD)
+    fprintf(stderr, "zstd input needs a build with \"make ZSTD=1\"\n");
+#endif
+
+  errno = ENOTSUP;
+  return DECOMPRESS_FAILURE;
+}
+
+static ssize_t decompress_gzip(decompressor* d, const char** in,
+                               size_t* inLen, char* out, size_t outSize){
+
+  z_stream* z = d->stream;
+  int ret;
+
+  z->next_in = (Bytef*)*in;
+  z->avail_in = *inLen;
+  z->next_out = (Bytef*)out;
+  z->avail_out = outSize;
+
+  while(z->avail_out > 0){
+    /* Another member follows the one that just ended, unless what follows
+     * is the NUL padding tar and tape tools leave after the last one */
+    if(d->finished){
+      while(z->avail_in > 0 && *z->next_in == 0){
+        z->next_in++;
+        z->avail_in--;
+      }
+      if(z->avail_in == 0)
+        break;
+      if(inflateReset(z) != Z_OK)
+        return DECOMPRESS_FAILURE;
+      d->finished = 0;
+    }
+    ret = inflate(z, Z_NO_FLUSH);
+    if(ret == Z_STREAM_END)
+      d->finished = 1;
+    else if(ret == Z_BUF_ERROR)
+      break; // No progress possible without more input
+    else if(ret != Z_OK){
+      /* Hand back what was decoded before the error; the next call fails */
+      if(z->avail_out == outSize)
+        return DECOMPRESS_FAILURE;
+      break;
+    }
+  }
+
+  *in = (const char*)z->next_in;
+  *inLen = z->avail_in;
+  return outSize - z->avail_out;
+}
+
+#ifdef HAVE_ZSTD
+static ssize_t decompress_zstd(decompressor* d, const char** in,
+                               size_t* inLen, char* out, size_t outSize){
+
+  ZSTD_inBuffer input = {*in, *inLen, 0};
+  ZSTD_outBuffer output = {out, outSize, 0};
+  size_t inPos;
+  size_t outPos;
+  size_t ret;
+
+  while(output.pos < output.size){
+    inPos = input.pos;
+    outPos = output.pos;
+    ret = ZSTD_decompressStream(d->stream, &output, &input);
+    if(ZSTD_isError(ret)){
+      if(output.pos == 0)
+        return DECOMPRESS_FAILURE;
+      break;
+    }
+    d->finished = ret == 0;
+    if(input.pos == inPos && output.pos == outPos)
+      break;
+  }
+
+  *in += input.pos;
+  *inLen -= input.pos;
+  return output.pos;
+}
+#endif
+
+ssize_t decompress_run(decompressor* d, const char** in, size_t* inLen,
+                       char* out, size_t outSize){
+
+  size_t before = *inLen;
+  ssize_t n = DECOMPRESS_FAILURE;
+
+  if(d->format == DECOMPRESS_GZIP)
+    n = decompress_gzip(d, in, inLen, out, outSize);
+#ifdef HAVE_ZSTD
+  else if(d->format == DECOMPRESS_ZSTD)
+    n = decompress_zstd(d, in, inLen, out, outSize);
+#endif
+
+  /* Input that the decoder will not take is garbage after the stream */
+  if(n == 0 && before > 0 && *inLen == before)
+    return DECOMPRESS_FAILURE;
+  return n;
+}
+
+void decompress_end(decompressor* d){
+
+  if(!d->stream)
+    return;
+  if(d->format == DECOMPRESS_GZIP){
+    inflateEnd(d->stream);
+    free(d->stream);
+  }
+#ifdef HAVE_ZSTD
+  else if(d->format == DECOMPRESS_ZSTD)
+    ZSTD_freeDStream(d->stream);
+#endif
+  d->stream = NULL;
+}
@@ -0,0 +1,53 @@
+/*
+ * File: decompress.h
+ * Author: Domenic Murtari
+ * Project: CSCI 3753 Programming Assignment 2
+ * Description: Streaming decompression of compressed input lists. gzip
+ *  input is handled through zlib. zstd input needs a build with
+ *  "make ZSTD=1" (libzstd-dev); without it a zstd file is detected and
+ *  reported as unsupported rather than parsed as hostnames.
+ *
+ */
+
+#ifndef DECOMPRESS_H
+#define DECOMPRESS_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#define DECOMPRESS_FAILURE -1
+#define DECOMPRESS_SUCCESS 0
+
+/* Input formats */
+#define DECOMPRESS_NONE 0
+#define DECOMPRESS_GZIP 1
+#define DECOMPRESS_ZSTD 2
+
+typedef struct decompressor_s{
+  int format;
+  void* stream;  // z_stream or ZSTD_DStream
+  int finished;  // Input so far ends on a member or frame boundary
+} decompressor;
+
+/* Returns the format of a file from its first bytes, DECOMPRESS_NONE if it
+ * does not look compressed */
+int decompress_detect(const char* data, size_t len);
+
+/* Name of a format for messages and statistics */
+const char* decompress_name(int format);
+
+/* Returns DECOMPRESS_SUCCESS, or DECOMPRESS_FAILURE with errno set if the
+ * format is not supported by this build or memory runs out */
+int decompress_init(decompressor* d, int format);
+
+/* Decompresses as much of *in as fits in out, advancing *in and *inLen past
+ * the input used. Concatenated gzip members and zstd frames are decoded as
+ * one stream. Once the input is exhausted, keep calling with *inLen 0 until
+ * it returns 0 to flush buffered output. Returns the number of bytes written
+ * to out, or DECOMPRESS_FAILURE if the input is corrupt */
+ssize_t decompress_run(decompressor* d, const char** in, size_t* inLen,
+                       char* out, size_t outSize);
+
+void decompress_end(decompressor* d);
+
+#endif
@@ -0,0 +1,1059 @@
+/*
+ * File: fileio.c
+ * Author: Domenic Murtari
+ * Project: CSCI 3753 Programming Assignment 2
+ * Description: Buffered input and output for the DNS lookup pipeline. Readers
+ *  keep FILEIO_READ_BLOCKS reads in flight ahead of the parser, and writers
+ *  hand filled blocks to a background thread that recycles each block as soon
+ *  as its write completes. The io_uring backend talks to the kernel through
+ *  the raw system calls so no extra library is needed; any setup failure
+ *  falls back to blocking read() and write(). A compressed input gets a
+ *  decoder thread that pulls blocks from the read layer and inflates them
+ *  into blocks of its own while the requester parses the previous one.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+#include "fileio.h"
+#include "decompress.h"
+#include "probes.h"
+#include "util.h"
+
+/* Block states */
+#define FILEIO_IDLE 0
+#define FILEIO_INFLIGHT 1
+#define FILEIO_READY 2
+
+/* Set by fileio_init when io_uring should be used */
+static int uringEnabled = 0;
+
+/* Decompression thread and its output blocks. Output blocks are filled and
+ * parsed in index order, so the state of the next one is all either side
+ * needs to check */
+struct fileio_decoder{
+  decompressor d;
+  fileio_block blocks[FILEIO_READ_BLOCKS];
+  fileio_block* first;   // Compressed block the format was detected in
+  int next;              // Output block the parser takes next
+  int done;              // No more output blocks will become ready
+  int error;             // errno for a read error or corrupt input
+  int stop;              // Reader closed before the end of input
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+  pthread_t thread;
+};
+
+/* A minimal io_uring instance with one buffer per ring entry */
+struct uring{
+  int fd;
+  unsigned entries;
+  unsigned pending;       // Entries queued but not yet submitted
+  unsigned active;        // Entries submitted but not yet reaped
+  int registered;         // Buffers registered for the _FIXED opcodes
+  unsigned* sqHead;
+  unsigned* sqTail;
+  unsigned* sqMask;
+  unsigned* sqArray;
+  struct io_uring_sqe* sqes;
+  unsigned* cqHead;
+  unsigned* cqTail;
+  unsigned* cqMask;
+  struct io_uring_cqe* cqes;
+  void* sqRing;
+  size_t sqRingSize;
+  void* cqRing;
+  size_t cqRingSize;
+  size_t sqesSize;
+  struct iovec* iov;      // One per block, used by the vectored fallback
+};
+
+static void uring_destroy(struct uring* ring){
+
+  if(!ring)
+    return;
+  if(ring->sqes)
+    munmap(ring->sqes, ring->sqesSize);
+  if(ring->cqRing && ring->cqRing != ring->sqRing)
+    munmap(ring->cqRing, ring->cqRingSize);
+  if(ring->sqRing)
+    munmap(ring->sqRing, ring->sqRingSize);
+  close(ring->fd);
+  free(ring->iov);
+  free(ring);
+}
+
+/*
+ * Sets up a ring with one entry per block and registers the blocks as fixed
+ * buffers. If registration is refused (usually RLIMIT_MEMLOCK), the ring still
+ * works through the vectored opcodes. Returns NULL if io_uring is unavailable.
+ */
+static struct uring* uring_create(fileio_block* blocks, unsigned count){
+
+  struct io_uring_params params;
+  struct uring* ring;
+  unsigned i;
+
+  ring = calloc(1, sizeof(*ring));
+  if(!ring)
+    return NULL;
+  ring->iov = calloc(count, sizeof(*ring->iov));
+  if(!ring->iov){
+    free(ring);
+    return NULL;
+  }
+
+  memset(&params, 0, sizeof(params));
+  ring->fd = syscall(__NR_io_uring_setup, count, &params);
+  if(ring->fd < 0){
+    free(ring->iov);
+    free(ring);
+    return NULL;
+  }
+  ring->entries = params.sq_entries;
+
+  /* Map the submission and completion rings and the entry array */
+  ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  ring->cqRingSize = params.cq_off.cqes +
+    params.cq_entries * sizeof(struct io_uring_cqe);
+  if(params.features & IORING_FEAT_SINGLE_MMAP){
+    if(ring->cqRingSize > ring->sqRingSize)
+      ring->sqRingSize = ring->cqRingSize;
+    ring->cqRingSize = ring->sqRingSize;
+  }
+  ring->sqRing = mmap(NULL, ring->sqRingSize, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+  if(ring->sqRing == MAP_FAILED){
+    ring->sqRing = NULL;
+    uring_destroy(ring);
+    return NULL;
+  }
+  if(params.features & IORING_FEAT_SINGLE_MMAP){
+    ring->cqRing = ring->sqRing;
+  }
+  else{
+    ring->cqRing = mmap(NULL, ring->cqRingSize, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring->fd,
+                        IORING_OFF_CQ_RING);
+    if(ring->cqRing == MAP_FAILED){
+      ring->cqRing = NULL;
+      uring_destroy(ring);
+      return NULL;
+    }
+  }
+  ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+  ring->sqes = mmap(NULL, ring->sqesSize, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+  if(ring->sqes == MAP_FAILED){
+    ring->sqes = NULL;
+    uring_destroy(ring);
+    return NULL;
+  }
+
+  ring->sqHead = (unsigned*)((char*)ring->sqRing + params.sq_off.head);
+  ring->sqTail = (unsigned*)((char*)ring->sqRing + params.sq_off.tail);
+  ring->sqMask = (unsigned*)((char*)ring->sqRing + params.sq_off.ring_mask);
+  ring->sqArray = (unsigned*)((char*)ring->sqRing + params.sq_off.array);
+  ring->cqHead = (unsigned*)((char*)ring->cqRing + params.cq_off.head);
+  ring->cqTail = (unsigned*)((char*)ring->cqRing + params.cq_off.tail);
+  ring->cqMask = (unsigned*)((char*)ring->cqRing + params.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe*)((char*)ring->cqRing + params.cq_off.cqes);
+
+  /* Register the blocks so the kernel can skip pinning them on every call */
+  for(i = 0; i < count; i++){
+    ring->iov[i].iov_base = blocks[i].data;
+    ring->iov[i].iov_len = FILEIO_BLOCK_SIZE;
+  }
+  ring->registered = syscall(__NR_io_uring_register, ring->fd,
+                             IORING_REGISTER_BUFFERS, ring->iov, count) == 0;
+
+  return ring;
+}
+
+/*
+ * Queues a read into, or a write from, the part of block b past b->done at
+ * file offset b->offset + b->done. Returns FILEIO_FAILURE if the ring is full.
+ */
+static int uring_queue(struct uring* ring, int fd, fileio_block* b,
+                       size_t len, int write){
+
+  struct io_uring_sqe* sqe;
+  unsigned tail;
+  unsigned head;
+  unsigned index;
+
+  tail = *ring->sqTail;
+  head = __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE);
+  if(tail - head >= ring->entries)
+    return FILEIO_FAILURE;
+
+  index = tail & *ring->sqMask;
+  sqe = &ring->sqes[index];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->fd = fd;
+  sqe->off = b->offset + b->done;
+  sqe->user_data = (uintptr_t)b;
+  if(ring->registered){
+    sqe->opcode = write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+    sqe->addr = (uintptr_t)(b->data + b->done);
+    sqe->len = len;
+    sqe->buf_index = b->index;
+  }
+  else{
+    ring->iov[b->index].iov_base = b->data + b->done;
+    ring->iov[b->index].iov_len = len;
+    sqe->opcode = write ? IORING_OP_WRITEV : IORING_OP_READV;
+    sqe->addr = (uintptr_t)&ring->iov[b->index];
+    sqe->len = 1;
+  }
+
+  ring->sqArray[index] = index;
+  __atomic_store_n(ring->sqTail, tail + 1, __ATOMIC_RELEASE);
+  ring->pending++;
+  return FILEIO_SUCCESS;
+}
+
+/*
+ * Submits queued entries and, if wait is set, blocks until at least one
+ * completion is available.
+ */
+static int uring_enter(struct uring* ring, int wait){
+
+  int ret;
+
+  do{
+    ret = syscall(__NR_io_uring_enter, ring->fd, ring->pending, wait ? 1 : 0,
+                  wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+  }while(ret < 0 && errno == EINTR);
+  if(ret < 0)
+    return FILEIO_FAILURE;
+  ring->pending -= ret;
+  ring->active += ret;
+  return FILEIO_SUCCESS;
+}
+
+/*
+ * Takes one completion off the ring if there is one. Returns 1 and fills in
+ * the block and result, or 0 if the completion queue is empty.
+ */
+static int uring_reap(struct uring* ring, fileio_block** b, int* res){
+
+  struct io_uring_cqe* cqe;
+  unsigned head;
+
+  head = *ring->cqHead;
+  if(head == __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE))
+    return 0;
+  cqe = &ring->cqes[head & *ring->cqMask];
+  *b = (fileio_block*)(uintptr_t)cqe->user_data;
+  *res = cqe->res;
+  __atomic_store_n(ring->cqHead, head + 1, __ATOMIC_RELEASE);
+  ring->active--;
+  return 1;
+}
+
+/*
+ * Waits for the next completion. Returns FILEIO_FAILURE if the kernel call
+ * fails.
+ */
+static int uring_wait(struct uring* ring, fileio_block** b, int* res){
+
+  while(!uring_reap(ring, b, res)){
+    if(uring_enter(ring, 1) == FILEIO_FAILURE)
+      return FILEIO_FAILURE;
+  }
+  return FILEIO_SUCCESS;
+}
+
+/*
+ * Stops all I/O on a ring: drops entries that were queued but never
+ * submitted, then waits for the kernel to finish the rest. Returns
+ * FILEIO_FAILURE if waiting fails, in which case the kernel may still be
+ * using the buffers of submitted entries.
+ */
+static int uring_quiesce(struct uring* ring){
+
+  fileio_block* b;
+  int res;
+
+  /* Without SQPOLL the kernel only reads the queue in io_uring_enter */
+  __atomic_store_n(ring->sqTail, __atomic_load_n(ring->sqHead,
+                                                 __ATOMIC_ACQUIRE),
+                   __ATOMIC_RELEASE);
+  ring->pending = 0;
+
+  while(ring->active > 0){
+    if(uring_reap(ring, &b, &res))
+      continue;
+    if(uring_enter(ring, 1) == FILEIO_FAILURE)
+      return FILEIO_FAILURE;
+  }
+  return FILEIO_SUCCESS;
+}
+
+static int alloc_blocks(fileio_block* blocks, int count){
+
+  int i;
+
+  memset(blocks, 0, sizeof(*blocks) * count);
+  for(i = 0; i < count; i++){
+    blocks[i].index = i;
+    blocks[i].data = malloc(FILEIO_BLOCK_SIZE);
+    if(!blocks[i].data){
+      perror("Error on fileio block Malloc");
+      return FILEIO_FAILURE;
+    }
+  }
+  return FILEIO_SUCCESS;
+}
+
+static void free_blocks(fileio_block* blocks, int count){
+
+  int i;
+
+  for(i = 0; i < count; i++)
+    free(blocks[i].data);
+}
+
+int fileio_init(int useUring){
+
+  fileio_block probe;
+  struct uring* ring;
+
+  uringEnabled = 0;
+  if(!useUring)
+    return 0;
+
+  /* Make sure the kernel lets us create a ring before committing to it */
+  if(alloc_blocks(&probe, 1) == FILEIO_FAILURE)
+    return 0;
+  ring = uring_create(&probe, 1);
+  if(ring){
+    uringEnabled = 1;
+    uring_destroy(ring);
+  }
+  else{
+    fprintf(stderr, "io_uring unavailable (%s), using blocking I/O\n",
+            strerror(errno));
+  }
+  free_blocks(&probe, 1);
+  return uringEnabled;
+}
+
+/*
+ * Gives every idle block a read at the next read-ahead offset.
+ */
+static int reader_fill(fileio_reader* r){
+
+  int i;
+
+  for(i = 0; i < FILEIO_READ_BLOCKS; i++){
+    if(r->blocks[i].state != FILEIO_IDLE)
+      continue;
+    r->blocks[i].offset = r->submitPos;
+    r->blocks[i].done = 0;
+    if(uring_queue(r->ring, r->fd, &r->blocks[i], FILEIO_BLOCK_SIZE, 0)
+       == FILEIO_FAILURE)
+      break;
+    r->blocks[i].state = FILEIO_INFLIGHT;
+    r->submitPos += FILEIO_BLOCK_SIZE;
+  }
+  return uring_enter(r->ring, 0);
+}
+
+/*
+ * Waits for one read to finish and records its result in its block.
+ */
+static int reader_complete(fileio_reader* r){
+
+  fileio_block* b;
+  int res;
+
+  if(uring_wait(r->ring, &b, &res) == FILEIO_FAILURE)
+    return FILEIO_FAILURE;
+  b->state = FILEIO_READY;
+  b->error = res < 0 ? -res : 0;
+  b->len = res < 0 ? 0 : (size_t)res;
+  return FILEIO_SUCCESS;
+}
+
+static fileio_block* reader_find(fileio_reader* r){
+
+  int i;
+
+  for(i = 0; i < FILEIO_READ_BLOCKS; i++){
+    if(r->blocks[i].state != FILEIO_IDLE && r->blocks[i].offset == r->readPos)
+      return &r->blocks[i];
+  }
+  return NULL;
+}
+
+/*
+ * Reads the next block of the file into *out. The previous block is reused,
+ * so the caller must be done with it. Returns 1 on success, 0 at end of file
+ * and FILEIO_FAILURE on error.
+ */
+static int reader_next_block(fileio_reader* r, fileio_block** out){
+
+  fileio_block* b;
+  ssize_t n;
+  int i;
+
+  if(r->eof)
+    return 0;
+
+  /* Blocking reads use a single block */
+  if(!r->ring){
+    do{
+      n = read(r->fd, r->blocks[0].data, FILEIO_BLOCK_SIZE);
+    }while(n < 0 && errno == EINTR);
+    if(n <= 0){
+      r->eof = 1;
+      return n < 0 ? FILEIO_FAILURE : 0;
+    }
+    r->raw = &r->blocks[0];
+    r->raw->len = n;
+    *out = r->raw;
+    return 1;
+  }
+
+  /* Recycle the block just used into a new read-ahead */
+  if(r->raw){
+    r->raw->state = FILEIO_IDLE;
+    r->raw = NULL;
+  }
+  if(reader_fill(r) == FILEIO_FAILURE)
+    return FILEIO_FAILURE;
+
+  /* A short read leaves the read-aheads at the wrong offsets. Drain them and
+   * start over from where the data actually ended */
+  if(!(b = reader_find(r))){
+    for(i = 0; i < FILEIO_READ_BLOCKS; i++){
+      while(r->blocks[i].state == FILEIO_INFLIGHT){
+        if(reader_complete(r) == FILEIO_FAILURE)
+          return FILEIO_FAILURE;
+      }
+      r->blocks[i].state = FILEIO_IDLE;
+    }
+    r->submitPos = r->readPos;
+    if(reader_fill(r) == FILEIO_FAILURE)
+      return FILEIO_FAILURE;
+    b = reader_find(r);
+  }
+
+  while(b->state == FILEIO_INFLIGHT){
+    if(reader_complete(r) == FILEIO_FAILURE)
+      return FILEIO_FAILURE;
+  }
+  if(b->error){
+    errno = b->error;
+    return FILEIO_FAILURE;
+  }
+  if(b->len == 0){
+    r->eof = 1;
+    return 0;
+  }
+
+  r->raw = b;
+  r->readPos += b->len;
+  *out = b;
+  return 1;
+}
+
+/*
+ * Decoder thread. Fills each output block in turn with decompressed data,
+ * reading compressed blocks from the file as the decompressor needs them.
+ */
+static void* decoder_main(void* arg){
+
+  fileio_reader* r = arg;
+  struct fileio_decoder* dec = r->decoder;
+  fileio_block* in = dec->first;
+  fileio_block* out;
+  const char* data = in->data;
+  size_t avail = in->len;
+  long long started;
+  ssize_t n;
+  int inputDone = 0;
+  int error = 0;
+  int end = 0;
+  int ret;
+  int k = 0;
+
+  r->decoded.in += avail;
+  while(!end){
+    /* Wait for the parser to give the next output block back */
+    out = &dec->blocks[k];
+    pthread_mutex_lock(&dec->lock);
+    while(out->state != FILEIO_IDLE && !dec->stop)
+      pthread_cond_wait(&dec->changed, &dec->lock);
+    end = dec->stop;
+    pthread_mutex_unlock(&dec->lock);
+    if(end)
+      break;
+
+    out->len = 0;
+    while(out->len < FILEIO_BLOCK_SIZE){
+      if(avail == 0 && !inputDone){
+        if((ret = reader_next_block(r, &in)) < 0){
+          error = errno;
+          break;
+        }
+        if(ret == 0){
+          inputDone = 1;
+        }
+        else{
+          data = in->data;
+          avail = in->len;
+          r->decoded.in += avail;
+        }
+      }
+
+      started = util_now_ns();
+      n = decompress_run(&dec->d, &data, &avail, out->data + out->len,
+                         FILEIO_BLOCK_SIZE - out->len);
+      r->decoded.ns += util_now_ns() - started;
+      if(n < 0){
+        error = EBADMSG;
+        break;
+      }
+      out->len += n;
+
+      /* All input used and all output flushed */
+      if(inputDone && n == 0){
+        if(!dec->d.finished)
+          error = EBADMSG; // Truncated
+        end = 1;
+        break;
+      }
+    }
+    if(error)
+      end = 1;
+    r->decoded.out += out->len;
+
+    pthread_mutex_lock(&dec->lock);
+    if(out->len > 0)
+      out->state = FILEIO_READY;
+    if(end){
+      dec->done = 1;
+      dec->error = error;
+    }
+    pthread_cond_broadcast(&dec->changed);
+    pthread_mutex_unlock(&dec->lock);
+    k = (k + 1) % FILEIO_READ_BLOCKS;
+  }
+
+  return NULL;
+}
+
+/*
+ * Starts a decoder thread for a compressed input whose first block is b.
+ */
+static int decoder_start(fileio_reader* r, int format, fileio_block* b){
+
+  struct fileio_decoder* dec;
+
+  if(!(dec = calloc(1, sizeof(*dec))))
+    return FILEIO_FAILURE;
+  if(decompress_init(&dec->d, format) == DECOMPRESS_FAILURE){
+    free(dec);
+    return FILEIO_FAILURE;
+  }
+  if(alloc_blocks(dec->blocks, FILEIO_READ_BLOCKS) == FILEIO_FAILURE){
+    free_blocks(dec->blocks, FILEIO_READ_BLOCKS);
+    decompress_end(&dec->d);
+    free(dec);
+    return FILEIO_FAILURE;
+  }
+  dec->first = b;
+  pthread_mutex_init(&dec->lock, NULL);
+  pthread_cond_init(&dec->changed, NULL);
+  r->decoder = dec;
+  r->decoded.format = decompress_name(format);
+
+  if(pthread_create(&dec->thread, NULL, decoder_main, r)){
+    fprintf(stderr, "Error: Creating decoder thread failed\n");
+    pthread_mutex_destroy(&dec->lock);
+    pthread_cond_destroy(&dec->changed);
+    free_blocks(dec->blocks, FILEIO_READ_BLOCKS);
+    decompress_end(&dec->d);
+    free(dec);
+    r->decoder = NULL;
+    return FILEIO_FAILURE;
+  }
+  return FILEIO_SUCCESS;
+}
+
+/*
+ * Hands the block just parsed back to the decoder and waits for the next
+ * one. Returns 1 on success, 0 at end of input and FILEIO_FAILURE on error.
+ */
+static int decoder_next(fileio_reader* r){
+
+  struct fileio_decoder* dec = r->decoder;
+  fileio_block* b;
+
+  pthread_mutex_lock(&dec->lock);
+  if(r->current){
+    r->current->state = FILEIO_IDLE;
+    r->current = NULL;
+    dec->next = (dec->next + 1) % FILEIO_READ_BLOCKS;
+    pthread_cond_broadcast(&dec->changed);
+  }
+  b = &dec->blocks[dec->next];
+  while(b->state != FILEIO_READY && !dec->done)
+    pthread_cond_wait(&dec->changed, &dec->lock);
+  pthread_mutex_unlock(&dec->lock);
+
+  if(b->state != FILEIO_READY){
+    if(dec->error){
+      errno = dec->error;
+      return FILEIO_FAILURE;
+    }
+    return 0;
+  }
+  r->current = b;
+  r->pos = 0;
+  return 1;
+}
+
+/*
+ * Makes the next block of input current, decompressed if the first block
+ * shows the input is compressed. Returns 1 on success, 0 at end of file and
+ * FILEIO_FAILURE on error.
+ */
+static int reader_next(fileio_reader* r){
+
+  fileio_block* b;
+  int format;
+  int ret;
+
+  if(r->decoder)
+    return decoder_next(r);
+  if((ret = reader_next_block(r, &b)) <= 0)
+    return ret;
+
+  if(!r->started){
+    r->started = 1;
+    format = decompress_detect(b->data, b->len);
+    if(format != DECOMPRESS_NONE){
+      if(decoder_start(r, format, b) == FILEIO_FAILURE)
+        return FILEIO_FAILURE;
+      return decoder_next(r);
+    }
+  }
+
+  r->current = b;
+  r->pos = 0;
+  return 1;
+}
+
+int fileio_reader_open(fileio_reader* r, const char* path){
+
+  struct stat st;
+
+  memset(r, 0, sizeof(*r));
+  r->fd = open(path, O_RDONLY);
+  if(r->fd < 0)
+    return FILEIO_FAILURE;
+  if(alloc_blocks(r->blocks, FILEIO_READ_BLOCKS) == FILEIO_FAILURE){
+    fileio_reader_close(r);
+    return FILEIO_FAILURE;
+  }
+
+  /* Read-ahead at fixed offsets only makes sense for regular files */
+  if(uringEnabled && fstat(r->fd, &st) == 0 && S_ISREG(st.st_mode))
+    r->ring = uring_create(r->blocks, FILEIO_READ_BLOCKS);
+
+  return FILEIO_SUCCESS;
+}
+
+int fileio_read_name(fileio_reader* r, char* name, size_t size){
+
+  size_t n = 0;
+  int ret;
+  char c;
+
+  /* Skip leading whitespace */
+  while(1){
+    while(r->current && r->pos < r->current->len){
+      if(!isspace((unsigned char)r->current->data[r->pos]))
+        goto found;
+      r->pos++;
+    }
+    if((ret = reader_next(r)) <= 0)
+      return ret;
+  }
+
+ found:
+  /* Copy characters up to the next whitespace or size-1 characters */
+  while(n < size - 1){
+    if(!r->current || r->pos >= r->current->len){
+      if((ret = reader_next(r)) < 0)
+        return ret;
+      if(ret == 0)
+        break;
+    }
+    c = r->current->data[r->pos];
+    if(isspace((unsigned char)c))
+      break;
+    name[n++] = c;
+    r->pos++;
+  }
+  name[n] = '\0';
+  return 1;
+}
+
+void fileio_reader_close(fileio_reader* r){
+
+  struct fileio_decoder* dec = r->decoder;
+  fileio_block* b;
+  int res;
+  int i;
+
+  /* Stop the decoder first, since it uses the read layer */
+  if(dec){
+    pthread_mutex_lock(&dec->lock);
+    dec->stop = 1;
+    pthread_cond_broadcast(&dec->changed);
+    pthread_mutex_unlock(&dec->lock);
+    if(pthread_join(dec->thread, NULL))
+      fprintf(stderr, "Error: Joining decoder thread failed\n");
+    pthread_mutex_destroy(&dec->lock);
+    pthread_cond_destroy(&dec->changed);
+    free_blocks(dec->blocks, FILEIO_READ_BLOCKS);
+    decompress_end(&dec->d);
+    free(dec);
+    r->decoder = NULL;
+  }
+
+  /* The kernel may still be writing into the blocks */
+  if(r->ring){
+    for(i = 0; i < FILEIO_READ_BLOCKS; i++){
+      while(r->blocks[i].state == FILEIO_INFLIGHT){
+        if(uring_wait(r->ring, &b, &res) == FILEIO_FAILURE)
+          break;
+        b->state = FILEIO_READY;
+      }
+    }
+    uring_destroy(r->ring);
+  }
+  free_blocks(r->blocks, FILEIO_READ_BLOCKS);
+  if(r->fd >= 0)
+    close(r->fd);
+  r->fd = -1;
+}
+
+void fileio_decode_report(FILE* fp, const char* column, int index,
+                          const fileio_decode_stats* stats,
+                          const char* source, int* header){
+
+  if(!stats->format)
+    return;
+  if(!*header){
+    fprintf(fp, "%-5s %6s %10s %10s %6s %10s  %s\n", column, "Format",
+            "In MB", "Out MB", "Ratio", "Out MB/s", "Source");
+    *header = 1;
+  }
+  fprintf(fp, "%-5d %6s %10.2f %10.2f %6.2f %10.1f  %s\n", index,
+          stats->format, stats->in / 1e6, stats->out / 1e6,
+          stats->in ? (double)stats->out / stats->in : 0.0,
+          stats->ns ? stats->out * 1e3 / stats->ns : 0.0, source);
+}
+
+/*
+ * Returns a written block to the free list and wakes anyone waiting for one.
+ */
+static void writer_recycle(fileio_writer* w, fileio_block* b){
+
+  PROBE_OUTPUT_FLUSH(b->done, PROBE_ENABLED(output__flush) ?
+                     util_now_ns() - b->started : 0);
+  pthread_mutex_lock(&w->lock);
+  b->len = 0;
+  b->state = FILEIO_IDLE;
+  b->next = w->freeList;
+  w->freeList = b;
+  pthread_cond_broadcast(&w->changed);
+  pthread_mutex_unlock(&w->lock);
+}
+
+static void writer_fail(fileio_writer* w, int error){
+
+  pthread_mutex_lock(&w->lock);
+  if(!w->error)
+    w->error = error;
+  pthread_mutex_unlock(&w->lock);
+}
+
+/*
+ * Writes a block with blocking write() calls.
+ */
+static void writer_blocking(fileio_writer* w, fileio_block* b){
+
+  ssize_t n;
+
+  while(b->done < b->len){
+    n = write(w->fd, b->data + b->done, b->len - b->done);
+    if(n < 0 && errno == EINTR)
+      continue;
+    if(n <= 0){
+      writer_fail(w, n < 0 ? errno : EIO);
+      break;
+    }
+    b->done += n;
+  }
+  writer_recycle(w, b);
+}
+
+/*
+ * Finishes the writes still in flight with blocking positioned writes and
+ * recycles their blocks. If ring is set it has just failed, and no block is
+ * touched until the kernel is done with all of them. Should that wait fail
+ * too, each in-flight block moves its data to a new buffer and leaves the
+ * old one to the kernel, so a refilled block can never be written at an
+ * old offset.
+ */
+static void writer_fallback(fileio_writer* w, struct uring* ring){
+
+  fileio_block* b;
+  char* data;
+  ssize_t n;
+  int abandon = 0;
+  int i;
+
+  if(ring && uring_quiesce(ring) == FILEIO_FAILURE)
+    abandon = 1;
+
+  for(i = 0; i < FILEIO_WRITE_BLOCKS; i++){
+    b = &w->blocks[i];
+    if(b->state != FILEIO_INFLIGHT)
+      continue;
+    if(abandon){
+      if((data = malloc(FILEIO_BLOCK_SIZE))){
+        memcpy(data, b->data, b->len);
+        b->data = data;
+      }
+      else
+        writer_fail(w, ENOMEM);
+    }
+    while(b->done < b->len){
+      n = pwrite(w->fd, b->data + b->done, b->len - b->done,
+                 b->offset + b->done);
+      if(n < 0 && errno == EINTR)
+        continue;
+      if(n <= 0){
+        writer_fail(w, n < 0 ? errno : EIO);
+        break;
+      }
+      b->done += n;
+    }
+    writer_recycle(w, b);
+  }
+}
+
+/*
+ * Background thread that writes filled blocks in the order they were handed
+ * off and recycles each one when its write completes. If the ring fails, or
+ * a ring write does, the writes in flight and all later ones are done with
+ * blocking positioned writes instead.
+ */
+static void* writer_main(void* arg){
+
+  fileio_writer* w = arg;
+  fileio_block* batch;
+  fileio_block* b;
+  struct uring* ring = w->ring;
+  int inflight = 0;
+  int error = 0;
+  int res;
+
+  pthread_mutex_lock(&w->lock);
+  while(1){
+    while(!w->fullHead && !w->closing && inflight == 0)
+      pthread_cond_wait(&w->changed, &w->lock);
+    if(!w->fullHead && w->closing && inflight == 0)
+      break;
+    batch = w->fullHead;
+    w->fullHead = w->fullTail = NULL;
+    pthread_mutex_unlock(&w->lock);
+
+    /* Assign offsets in hand-off order so output order is preserved */
+    while(batch){
+      b = batch;
+      batch = batch->next;
+      b->done = 0;
+      if(PROBE_ENABLED(output__flush))
+        b->started = util_now_ns();
+      b->offset = w->offset;
+      w->offset += b->len;
+      if(!w->ring){
+        writer_blocking(w, b);
+        continue;
+      }
+      b->state = FILEIO_INFLIGHT;
+      inflight++;
+      if(ring && uring_queue(ring, w->fd, b, b->len, 1) == FILEIO_FAILURE)
+        error = EBUSY;
+    }
+
+    /* Reap at least one write, resubmitting the rest of any short write */
+    if(ring && inflight && !error){
+      if(uring_enter(ring, 1) == FILEIO_FAILURE)
+        error = errno;
+      while(!error && inflight && uring_reap(ring, &b, &res)){
+        if(res <= 0){
+          error = res < 0 ? -res : EIO; // b stays in flight for the fallback
+          continue;
+        }
+        if((b->done += res) < b->len){
+          if(uring_queue(ring, w->fd, b, b->len - b->done, 1)
+             == FILEIO_FAILURE)
+            error = EBUSY;
+          continue;
+        }
+        writer_recycle(w, b);
+        inflight--;
+      }
+    }
+
+    /* Once the ring has failed, stop using it. Only a failed blocking
+     * write is an error for the caller */
+    if(error && inflight){
+      if(ring)
+        fprintf(stderr, "Warning: io_uring write failed (%s), using blocking "
+                "writes\n", strerror(error));
+      writer_fallback(w, ring);
+      ring = NULL;
+      inflight = 0;
+    }
+
+    pthread_mutex_lock(&w->lock);
+  }
+  pthread_mutex_unlock(&w->lock);
+
+  return NULL;
+}
+
+int fileio_writer_open(fileio_writer* w, FILE* fp){
+
+  struct stat st;
+  int i;
+
+  memset(w, 0, sizeof(*w));
+  fflush(fp);
+  w->fd = fileno(fp);
+  if(alloc_blocks(w->blocks, FILEIO_WRITE_BLOCKS) == FILEIO_FAILURE){
+    free_blocks(w->blocks, FILEIO_WRITE_BLOCKS);
+    return FILEIO_FAILURE;
+  }
+
+  /* Positioned writes need a regular file */
+  w->offset = lseek(w->fd, 0, SEEK_CUR);
+  if(uringEnabled && w->offset >= 0 && fstat(w->fd, &st) == 0 &&
+     S_ISREG(st.st_mode))
+    w->ring = uring_create(w->blocks, FILEIO_WRITE_BLOCKS);
+
+  w->current = &w->blocks[0];
+  for(i = FILEIO_WRITE_BLOCKS - 1; i > 0; i--){
+    w->blocks[i].next = w->freeList;
+    w->freeList = &w->blocks[i];
+  }
+
+  pthread_mutex_init(&w->lock, NULL);
+  pthread_cond_init(&w->changed, NULL);
+  if(pthread_create(&w->thread, NULL, writer_main, w)){
+    fprintf(stderr, "Error: Creating writer thread failed\n");
+    uring_destroy(w->ring);
+    free_blocks(w->blocks, FILEIO_WRITE_BLOCKS);
+    return FILEIO_FAILURE;
+  }
+
+  return FILEIO_SUCCESS;
+}
+
+/*
+ * Queues the current block for the writer thread. Must hold w->lock.
+ */
+static void writer_handoff(fileio_writer* w){
+
+  w->current->next = NULL;
+  if(w->fullTail)
+    w->fullTail->next = w->current;
+  else
+    w->fullHead = w->current;
+  w->fullTail = w->current;
+  w->current = NULL;
+  pthread_cond_broadcast(&w->changed);
+}
+
+int fileio_write(fileio_writer* w, const char* data, size_t len){
+
+  size_t n;
+
+  while(len > 0){
+    n = FILEIO_BLOCK_SIZE - w->current->len;
+    if(n > len)
+      n = len;
+    memcpy(w->current->data + w->current->len, data, n);
+    w->current->len += n;
+    data += n;
+    len -= n;
+
+    /* Hand off a full block and take a free one */
+    if(w->current->len == FILEIO_BLOCK_SIZE){
+      pthread_mutex_lock(&w->lock);
+      writer_handoff(w);
+      while(!w->freeList)
+        pthread_cond_wait(&w->changed, &w->lock);
+      w->current = w->freeList;
+      w->freeList = w->freeList->next;
+      pthread_mutex_unlock(&w->lock);
+    }
+  }
+
+  return w->error ? FILEIO_FAILURE : FILEIO_SUCCESS;
+}
+
+int fileio_writer_close(fileio_writer* w){
+
+  int error;
+
+  pthread_mutex_lock(&w->lock);
+  if(w->current->len > 0)
+    writer_handoff(w);
+  w->closing = 1;
+  pthread_cond_broadcast(&w->changed);
+  pthread_mutex_unlock(&w->lock);
+
+  if(pthread_join(w->thread, NULL))
+    fprintf(stderr, "Error: Joining writer thread failed\n");
+
+  /* Positioned writes leave the descriptor offset alone */
+  if(w->ring)
+    lseek(w->fd, w->offset, SEEK_SET);
+
+  error = w->error;
+  uring_destroy(w->ring);
+  free_blocks(w->blocks, FILEIO_WRITE_BLOCKS);
+  pthread_mutex_destroy(&w->lock);
+  pthread_cond_destroy(&w->changed);
+
+  if(error){
+    errno = error;
+    perror("Error Writing Output File");
+    return FILEIO_FAILURE;
+  }
+  return FILEIO_SUCCESS;
+}
@@ -0,0 +1,120 @@
+/*
+ * File: fileio.h
+ * Author: Domenic Murtari
+ * Project: CSCI 3753 Programming Assignment 2
+ * Description: Declarations for the buffered input and output layer used by
+ *  the requester and resolver threads. Input is read ahead in large blocks and
+ *  output is written in large blocks by a background writer thread. When
+ *  io_uring is enabled and the kernel supports it, reads and writes go through
+ *  registered buffers on an io_uring instance; otherwise plain read() and
+ *  write() are used. gzip and zstd input is recognized by its first bytes and
+ *  decompressed by a background thread, one block ahead of the parser.
+ *
+ */
+
+#ifndef FILEIO_H
+#define FILEIO_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+#define FILEIO_FAILURE -1
+#define FILEIO_SUCCESS 0
+
+#define FILEIO_BLOCK_SIZE (64 * 1024) // Size of each read or write block
+#define FILEIO_READ_BLOCKS 2          // Blocks each reader keeps in flight
+#define FILEIO_WRITE_BLOCKS 8         // Blocks shared by a writer
+
+struct uring;
+struct fileio_decoder;
+
+/* One read or write buffer */
+typedef struct fileio_block_s{
+  char* data;
+  size_t len;        // Bytes of valid data
+  size_t done;       // Bytes of len already written
+  off_t offset;      // File offset the block was read from or written to
+  int error;         // errno from a failed read or write, 0 otherwise
+  int state;         // Idle, in flight, or ready to parse
+  int index;         // Position in the owner's block array
+  long long started; // When the write was queued, for the flush probe
+  struct fileio_block_s* next;
+} fileio_block;
+
+/* Decompression totals for one input */
+typedef struct fileio_decode_stats_s{
+  const char* format;        // "gzip" or "zstd", NULL for plain input
+  unsigned long long in;     // Compressed bytes read
+  unsigned long long out;    // Decompressed bytes produced
+  long long ns;              // Time spent decompressing
+} fileio_decode_stats;
+
+typedef struct fileio_reader_s{
+  int fd;
+  struct uring* ring;  // NULL when using blocking reads
+  fileio_block blocks[FILEIO_READ_BLOCKS];
+  fileio_block* raw;     // Block last returned by the file read layer
+  fileio_block* current; // Block being parsed
+  size_t pos;            // Parse position within current
+  off_t readPos;         // File offset of the first unread byte
+  off_t submitPos;       // File offset for the next read-ahead
+  int eof;
+  int started;           // First block has been checked for compression
+  struct fileio_decoder* decoder; // NULL for plain input
+  fileio_decode_stats decoded;    // Complete once the reader is closed
+} fileio_reader;
+
+typedef struct fileio_writer_s{
+  int fd;
+  struct uring* ring;       // NULL when using blocking writes
+  fileio_block blocks[FILEIO_WRITE_BLOCKS];
+  fileio_block* current;    // Block being filled by fileio_write
+  fileio_block* freeList;   // Blocks ready to be filled
+  fileio_block* fullHead;   // Filled blocks waiting for the writer thread
+  fileio_block* fullTail;
+  off_t offset;             // File offset for the next block
+  int closing;
+  int error;
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+  pthread_t thread;
+} fileio_writer;
+
+/* Chooses the backend for readers and writers opened afterwards. If useUring
+ * is set but io_uring is unavailable, prints a note and falls back to
+ * blocking I/O. Returns 1 if io_uring will be used, 0 otherwise */
+int fileio_init(int useUring);
+
+/* Opens path for reading, plain or compressed. Returns FILEIO_SUCCESS or
+ * FILEIO_FAILURE */
+int fileio_reader_open(fileio_reader* r, const char* path);
+
+/* Reads the next whitespace separated name, at most size-1 characters, the
+ * same way fscanf("%1024s") does. Returns 1 if a name was read, 0 at end of
+ * file and FILEIO_FAILURE on a read error */
+int fileio_read_name(fileio_reader* r, char* name, size_t size);
+
+void fileio_reader_close(fileio_reader* r);
+
+/* Prints the decompression totals of one compressed input as a row of a
+ * table whose first column is named column, printing the heading first if
+ * *header is 0. Does nothing for plain input */
+void fileio_decode_report(FILE* fp, const char* column, int index,
+                          const fileio_decode_stats* stats,
+                          const char* source, int* header);
+
+/* Starts a writer on an open stream. The stream must not be written to
+ * through stdio until fileio_writer_close returns */
+int fileio_writer_open(fileio_writer* w, FILE* fp);
+
+/* Appends len bytes to the output. Blocks only when every buffer is waiting
+ * to be written. Not thread safe; callers serialize */
+int fileio_write(fileio_writer* w, const char* data, size_t len);
+
+/* Flushes remaining output and stops the writer thread. Returns
+ * FILEIO_FAILURE if any write failed */
+int fileio_writer_close(fileio_writer* w);
+
+#endif
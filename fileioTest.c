@@ -0,0 +1,256 @@
+/*
+ * File: fileioTest.c
+ * Author: Domenic Murtari
+ * Project: CSCI 3753 Programming Assignment 2
+ * Description:
+ * 	This file contains test code for the block reader. It
+ *      checks that fileio_read_name splits an input file into
+ *      the same names as fscanf("%1024s"), with names on block
+ *      boundaries and names too long for one read, for plain
+ *      and gzip input with both I/O backends, and gzip input
+ *      followed by NUL padding.
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "fileio.h"
+#include "probes.h"
+
+PROBE_DEFINE_SEMAPHORES
+
+#define NAME_SIZE 1025
+#define INPUT_SIZE (6 * FILEIO_BLOCK_SIZE)
+
+/* NUL bytes after the gzip stream, enough to span a block boundary */
+#define PADDING_SIZE (FILEIO_BLOCK_SIZE + 100)
+
+/* Lengths of the long names placed across block boundaries */
+static const int longLengths[] = {1023, 1024, 1025, 3000};
+#define LONG_COUNT ((int)(sizeof(longLengths) / sizeof(longLengths[0])))
+
+/* Whitespace fscanf skips, cycled between names */
+static const char spaces[] = " \n\t\r\n  \v\f";
+
+/*
+ * Appends a name of len characters followed by some whitespace.
+ */
+static size_t put_name(char* buf, size_t pos, int len, int n){
+
+    int i;
+
+    for(i = 0; i < len; i++){
+	buf[pos++] = 'a' + (n + i) % 26;
+    }
+    for(i = 0; i <= n % 3; i++){
+	buf[pos++] = spaces[(n + i) % (sizeof(spaces) - 1)];
+    }
+    return pos;
+}
+
+/*
+ * Builds the test input. Each block boundary gets one long
+ * name straddling it, and the gaps are filled with short
+ * names. The last name has no whitespace after it.
+ */
+static size_t build_input(char* buf){
+
+    size_t pos = 0;
+    size_t boundary;
+    int n = 0;
+    int i;
+
+    for(i = 0; i < LONG_COUNT; i++){
+	boundary = (size_t)(i + 1) * FILEIO_BLOCK_SIZE;
+	while(pos + 40 < boundary - longLengths[i] / 2){
+	    pos = put_name(buf, pos, 5 + n % 30, n);
+	    n++;
+	}
+	pos = put_name(buf, pos, longLengths[i], n++);
+    }
+
+    /* A name that ends exactly on the next boundary */
+    boundary = (size_t)(LONG_COUNT + 1) * FILEIO_BLOCK_SIZE;
+    while(pos + 60 < boundary){
+	pos = put_name(buf, pos, 7, n++);
+    }
+    pos = put_name(buf, pos, boundary - pos, n++);
+    pos = put_name(buf, pos, 12, n++);
+    while(pos > 0 && strchr(spaces, buf[pos - 1])){
+	pos--;
+    }
+    return pos;
+}
+
+/*
+ * Reads names from path with fileio_read_name and compares them
+ * with the expected list. Returns the number of mismatches.
+ */
+static int check_reader(const char* label, const char* path,
+			char** expected, int count){
+
+    fileio_reader r;
+    char name[NAME_SIZE];
+    int ret;
+    int i = 0;
+    int failures = 0;
+
+    if(fileio_reader_open(&r, path) == FILEIO_FAILURE){
+	fprintf(stderr,
+		"error: %s: fileio_reader_open failed\n", label);
+	return 1;
+    }
+    while((ret = fileio_read_name(&r, name, sizeof(name))) == 1){
+	if(i >= count){
+	    i++;
+	    continue;
+	}
+	if(strcmp(name, expected[i])){
+	    fprintf(stderr,
+		    "error: %s: name %d is %zu characters, "
+		    "expected %zu\n", label, i,
+		    strlen(name), strlen(expected[i]));
+	    failures++;
+	}
+	i++;
+    }
+    if(ret == FILEIO_FAILURE){
+	fprintf(stderr,
+		"error: %s: fileio_read_name failed\n", label);
+	failures++;
+    }
+    if(i != count){
+	fprintf(stderr,
+		"error: %s: read %d names, expected %d\n",
+		label, i, count);
+	failures++;
+    }
+    fileio_reader_close(&r);
+    return failures;
+}
+
+int main(int argc, char* argv[]){
+
+    /* Void Unused Variables */
+    (void) argc;
+    (void) argv;
+
+    /* Setup local vars */
+    char plainPath[] = "/tmp/fileioTestXXXXXX";
+    char gzipPath[] = "/tmp/fileioTestGzXXXXXX";
+    char paddedPath[] = "/tmp/fileioTestPadXXXXXX";
+    char** expected;
+    char name[NAME_SIZE];
+    char label[64];
+    char* input;
+    char* padding;
+    size_t size;
+    FILE* fp;
+    gzFile gz;
+    int fd;
+    int count = 0;
+    int capacity = INPUT_SIZE / 2;
+    int i;
+    int backend;
+    int failures = 0;
+
+    input = malloc(INPUT_SIZE);
+    padding = calloc(1, PADDING_SIZE);
+    expected = malloc(capacity * sizeof(*expected));
+    if(!input || !padding || !expected){
+	fprintf(stderr,
+		"error: out of memory\n");
+	return EXIT_FAILURE;
+    }
+    size = build_input(input);
+
+    /* Write the plain and gzip copies */
+    if((fd = mkstemp(plainPath)) < 0 ||
+       write(fd, input, size) != (ssize_t)size){
+	perror("error: writing plain input");
+	return EXIT_FAILURE;
+    }
+    close(fd);
+    if((fd = mkstemp(gzipPath)) < 0){
+	perror("error: creating gzip input");
+	return EXIT_FAILURE;
+    }
+    close(fd);
+    if(!(gz = gzopen(gzipPath, "wb")) ||
+       gzwrite(gz, input, size) != (int)size ||
+       gzclose(gz) != Z_OK){
+	fprintf(stderr,
+		"error: writing gzip input failed\n");
+	return EXIT_FAILURE;
+    }
+
+    /* The same gzip stream followed by NUL padding */
+    if((fd = mkstemp(paddedPath)) < 0){
+	perror("error: creating padded input");
+	return EXIT_FAILURE;
+    }
+    close(fd);
+    if(!(gz = gzopen(paddedPath, "wb")) ||
+       gzwrite(gz, input, size) != (int)size ||
+       gzclose(gz) != Z_OK ||
+       !(fp = fopen(paddedPath, "a")) ||
+       fwrite(padding, 1, PADDING_SIZE, fp) != PADDING_SIZE ||
+       fclose(fp)){
+	fprintf(stderr,
+		"error: writing padded input failed\n");
+	return EXIT_FAILURE;
+    }
+
+    /* Expected names, from fscanf */
+    if(!(fp = fopen(plainPath, "r"))){
+	perror("error: opening plain input");
+	return EXIT_FAILURE;
+    }
+    while(count < capacity && fscanf(fp, "%1024s", name) > 0){
+	if(!(expected[count++] = strdup(name))){
+	    fprintf(stderr,
+		    "error: out of memory\n");
+	    return EXIT_FAILURE;
+	}
+    }
+    fclose(fp);
+
+    /* Compare with both backends */
+    for(backend = 0; backend < 2; backend++){
+	if(fileio_init(backend) != backend){
+	    fprintf(stderr,
+		    "io_uring unavailable, "
+		    "skipping that backend\n");
+	    break;
+	}
+	snprintf(label, sizeof(label), "%s plain",
+		 backend ? "io_uring" : "blocking");
+	failures += check_reader(label, plainPath, expected, count);
+	snprintf(label, sizeof(label), "%s gzip",
+		 backend ? "io_uring" : "blocking");
+	failures += check_reader(label, gzipPath, expected, count);
+	snprintf(label, sizeof(label), "%s padded gzip",
+		 backend ? "io_uring" : "blocking");
+	failures += check_reader(label, paddedPath, expected, count);
+    }
+
+    unlink(plainPath);
+    unlink(gzipPath);
+    unlink(paddedPath);
+    for(i = 0; i < count; i++){
+	free(expected[i]);
+    }
+    free(input);
+    free(padding);
+    free(expected);
+
+    if(!failures){
+	printf("fileioTest: %d names matched fscanf\n", count);
+    }
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
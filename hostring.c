@@ -0,0 +1,12 @@
+/*
+ * File: hostring.c
+ * Author: Domenic Murtari
+ * Project: CSCI 3753 Programming Assignment 2
+ * Description:
+ * 	Instantiates the hostname ring declared in hostring.h.
+ *
+ */
+
+#include "hostring.h"
+
+RING_DEFINE(hostring, HOSTRING_SLOT_SIZE)
@@ -0,0 +1,21 @@
+/*
+ * File: hostring.h
+ * Author: Domenic Murtari
+ * Project: CSCI 3753 Programming Assignment 2
+ * Description:
+ * 	Ring of hostnames passed from requesters to resolvers. Each slot is
+ *      one cache line, so names shorter than 56 characters (nearly all of
+ *      them) are stored inline.
+ *
+ */
+
+#ifndef HOSTRING_H
+#define HOSTRING_H
+
+#include "ring.h"
+
+#define HOSTRING_SLOT_SIZE RING_CACHE_LINE
+
+RING_DECLARE(hostring, HOSTRING_SLOT_SIZE)
+
+#endif
@@ -0,0 +1,196 @@
+/*
+ * File: incremental.c
+ * Author: Domenic Murtari
+ * Project: CSCI 3753 Programming Assignment 2
+ * Description: Previous-results index and change report for incremental
+ *  runs. The index is built once before any threads start and is read-only
+ *  afterwards except for the per-entry seen flag, so requesters and
+ *  resolvers can look names up without a lock.
+ *
+ */
+
+#include <stddef.h>
+#include <sys/stat.h>
+
+#include "incremental.h"
+#include "fileio.h"
+
+/* Longest line in a results file: name, ip and timestamp */
+#define INC_LINE_LENGTH (MAX_NAME_LENGTH + INET6_ADDRSTRLEN + 32)
+
+int inc_load(struct inc_index* index, const char* path, time_t maxAge,
+             FILE* report){
+
+  fileio_reader input;
+  struct stat st;
+  char line[INC_LINE_LENGTH];
+  char* ip;
+  char* stamp;
+  char* end;
+  size_t* offsets = NULL;
+  struct inc_entry* entries = NULL;
+  struct util_name_pool pool = {NULL, 0, 0};
+  size_t capacity = 0;
+  size_t offsetsCapacity = 0;
+  size_t count = 0;
+  size_t i;
+  void* grown;
+  unsigned int* slot;
+  int ret;
+
+  memset(index, 0, sizeof(*index));
+  index->now = time(NULL);
+  index->maxAge = maxAge;
+  index->report = report;
+  pthread_mutex_init(&index->reportMutex, NULL);
+
+  if(stat(path, &st) < 0 ||
+     fileio_reader_open(&input, path) == FILEIO_FAILURE){
+    perror("Error Opening Previous Results");
+    return UTIL_FAILURE;
+  }
+
+  /* Each line is one whitespace separated token: name,ip[,stamp] */
+  while((ret = fileio_read_name(&input, line, sizeof(line))) > 0){
+    if(!(ip = strchr(line, ','))){
+      fprintf(stderr, "%s: skipping malformed line: %s\n", path, line);
+      continue;
+    }
+    *ip++ = '\0';
+    if((stamp = strchr(ip, ',')))
+      *stamp++ = '\0';
+
+    if(!(grown = util_array_grow(entries, &capacity, count,
+                                 sizeof(*entries), 1024)))
+      goto nomem;
+    entries = grown;
+    if(!(grown = util_array_grow(offsets, &offsetsCapacity, count,
+                                 sizeof(*offsets), 1024)))
+      goto nomem;
+    offsets = grown;
+    if(util_name_pool_add(&pool, line, &offsets[count]) == UTIL_FAILURE)
+      goto nomem;
+
+    memset(&entries[count], 0, sizeof(entries[count]));
+    strncpy(entries[count].ip, ip, sizeof(entries[count].ip) - 1);
+    entries[count].stamp = st.st_mtime;
+    if(stamp){
+      entries[count].stamp = strtol(stamp, &end, 10);
+      if(*end != '\0')
+        entries[count].stamp = st.st_mtime;
+    }
+    count++;
+  }
+  fileio_reader_close(&input);
+  if(ret < 0){
+    perror("Error Reading Previous Results");
+    goto fail;
+  }
+
+  /* Index the names. A name listed twice keeps its last answer */
+  index->names = pool.names;
+  memset(&pool, 0, sizeof(pool));
+  index->entries = entries;
+  if(util_name_table_init(&index->table, count, entries, sizeof(*entries),
+                          offsetof(struct inc_entry, name)) == UTIL_FAILURE)
+    goto fail;
+  for(i = 0; i < count; i++){
+    entries[i].name = index->names + offsets[i];
+    slot = util_name_table_slot(&index->table, entries[i].name);
+    if(*slot){
+      strcpy(entries[*slot - 1].ip, entries[i].ip);
+      entries[*slot - 1].stamp = entries[i].stamp;
+      entries[i].seen = 1;
+      continue;
+    }
+    *slot = i + 1;
+  }
+  index->count = count;
+
+  free(offsets);
+  return UTIL_SUCCESS;
+
+ nomem:
+  perror("Error Loading Previous Results");
+  fileio_reader_close(&input);
+ fail:
+  free(offsets);
+  util_name_pool_free(&pool);
+  index->entries = entries;
+  inc_free(index);
+  return UTIL_FAILURE;
+}
+
+struct inc_entry* inc_find(struct inc_index* index, const char* name){
+
+  unsigned int* slot;
+  struct inc_entry* entry;
+
+  if(!index->table.slots)
+    return NULL;
+  slot = util_name_table_slot(&index->table, name);
+  if(!*slot)
+    return NULL;
+  entry = &index->entries[*slot - 1];
+  __atomic_store_n(&entry->seen, 1, __ATOMIC_RELAXED);
+  return entry;
+}
+
+int inc_use_previous(struct inc_index* index, struct inc_entry* entry){
+
+  if(!entry || entry->ip[0] == '\0' ||
+     index->now - entry->stamp >= index->maxAge)
+    return 0;
+  __atomic_add_fetch(&index->carried, 1, __ATOMIC_RELAXED);
+  return 1;
+}
+
+void inc_record(struct inc_index* index, const char* name,
+                const struct inc_entry* previous, const char* ip){
+
+  pthread_mutex_lock(&index->reportMutex);
+  index->resolved++;
+  if(!previous){
+    index->added++;
+    if(index->report)
+      fprintf(index->report, "added %s %s\n", name, ip[0] ? ip : "-");
+  }
+  else if(strcmp(previous->ip, ip)){
+    index->changed++;
+    if(index->report){
+      fprintf(index->report, "changed %s %s %s\n", name,
+              previous->ip[0] ? previous->ip : "-", ip[0] ? ip : "-");
+    }
+  }
+  pthread_mutex_unlock(&index->reportMutex);
+}
+
+void inc_finish(struct inc_index* index){
+
+  size_t i;
+
+  for(i = 0; i < index->count; i++){
+    if(index->entries[i].seen)
+      continue;
+    index->removed++;
+    if(index->report){
+      fprintf(index->report, "removed %s %s\n", index->entries[i].name,
+              index->entries[i].ip[0] ? index->entries[i].ip : "-");
+    }
+  }
+
+  fprintf(stderr, "Incremental: %lu carried over, %lu resolved "
+          "(%lu added, %lu changed), %lu removed\n", index->carried,
+          index->resolved, index->added, index->changed, index->removed);
+}
+
+void inc_free(struct inc_index* index){
+
+  free(index->entries);
+  util_name_table_free(&index->table);
+  free(index->names);
+  pthread_mutex_destroy(&index->reportMutex);
+  index->entries = NULL;
+  index->names = NULL;
+  index->count = 0;
+}
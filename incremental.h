@@ -0,0 +1,79 @@
+/*
+ * File: incremental.h
+ * Author: Domenic Murtari
+ * Project: CSCI 3753 Programming Assignment 2
+ * Description: Declarations for incremental runs. A previous results file is
+ *  loaded into a hash index; names whose previous answer is still fresh are
+ *  copied to the new output without a lookup, and only new, stale or
+ *  previously failed names are resolved. Differences from the previous run
+ *  are written to a change report.
+ *
+ *  In incremental mode each output line carries the time it was resolved:
+ *
+ *    hostname,ip,unixtime
+ *
+ *  A previous file without that field (a normal results file) is treated as
+ *  if every line was resolved when the file was last modified.
+ *
+ */
+
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "multi-lookup.h"
+
+/* Default age after which a previous answer is looked up again */
+#define INC_MAX_AGE (24 * 60 * 60)
+
+struct inc_entry{
+  const char* name;
+  char ip[INET6_ADDRSTRLEN];  // Empty if the previous lookup failed
+  time_t stamp;               // When the previous answer was resolved
+  int seen;                   // Set once the name shows up in the new input
+};
+
+struct inc_index{
+  struct inc_entry* entries;
+  size_t count;
+  struct util_name_table table; // Names to entries
+  char* names;                // Pool of NUL terminated names
+  time_t now;                 // Start of this run
+  time_t maxAge;
+  FILE* report;               // Change report, or NULL for counts only
+  pthread_mutex_t reportMutex;
+  unsigned long carried;      // Fresh answers copied without a lookup
+  unsigned long resolved;     // Names looked up this run
+  unsigned long added;
+  unsigned long changed;
+  unsigned long removed;
+};
+
+/* Loads a previous results file. report may be NULL. Returns UTIL_SUCCESS
+ * or UTIL_FAILURE */
+int inc_load(struct inc_index* index, const char* path, time_t maxAge,
+             FILE* report);
+
+/* Finds the previous entry for a name and marks it seen. Returns NULL if the
+ * name was not in the previous results */
+struct inc_entry* inc_find(struct inc_index* index, const char* name);
+
+/* Returns 1 if entry holds a successful answer younger than the maximum age
+ * and counts it as carried over, 0 if it must be resolved again */
+int inc_use_previous(struct inc_index* index, struct inc_entry* entry);
+
+/* Records a fresh answer for a name, reporting it as added or changed
+ * compared to the previous entry (NULL if the name is new) */
+void inc_record(struct inc_index* index, const char* name,
+                const struct inc_entry* previous, const char* ip);
+
+/* Reports every previous name that did not appear in the new input, then
+ * prints a summary to stderr */
+void inc_finish(struct inc_index* index);
+
+void inc_free(struct inc_index* index);
+
+#endif
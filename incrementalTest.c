@@ -0,0 +1,235 @@
+/*
+ * File: incrementalTest.c
+ * Author: Domenic Murtari
+ * Project: CSCI 3753 Programming Assignment 2
+ * Description:
+ * 	This file contains test code for incremental runs. It runs
+ *      ./multi-lookup with --previous on names that are still
+ *      fresh, together with --overrides and with --replay, and
+ *      checks that fresh names are carried over unchanged while
+ *      overridden and replayed names get their new answers and
+ *      are reported as changed.
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#define MULTI_LOOKUP "./multi-lookup"
+#define PATH_SIZE 64
+#define LINE_SIZE 1100
+
+/* Previous answers, all fresh */
+static const char* previousNames[] = {"a.example.com", "b.example.com",
+				      "c.example.com"};
+static const char* previousIps[] = {"10.0.0.1", "10.0.0.2", "10.0.0.3"};
+#define PREVIOUS_COUNT 3
+
+/* Temporary files */
+enum{PREVIOUS, HOSTS, TRACE, INPUT, OUTPUT, REPORT, FILE_COUNT};
+static char paths[FILE_COUNT][PATH_SIZE];
+
+static int write_file(const char* path, const char* text){
+
+    FILE* fp;
+
+    if(!(fp = fopen(path, "w"))){
+	perror("error: writing test file");
+	return -1;
+    }
+    fputs(text, fp);
+    fclose(fp);
+    return 0;
+}
+
+/*
+ * Runs multi-lookup with the given options before the input and
+ * output files, hiding its output. Returns its exit status.
+ */
+static int run(const char* option, const char* value){
+
+    pid_t pid;
+    int status;
+
+    if((pid = fork()) < 0){
+	perror("error: fork");
+	return -1;
+    }
+    if(pid == 0){
+	if(!freopen("/dev/null", "w", stdout) ||
+	   !freopen("/dev/null", "w", stderr)){
+	    _exit(127);
+	}
+	execl(MULTI_LOOKUP, MULTI_LOOKUP, "--previous", paths[PREVIOUS],
+	      "--report", paths[REPORT], option, value, paths[INPUT],
+	      paths[OUTPUT], (char*)NULL);
+	_exit(127);
+    }
+    if(waitpid(pid, &status, 0) < 0){
+	perror("error: waitpid");
+	return -1;
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+/*
+ * Checks that the output gives name the address ip, and that
+ * the line keeps the previous time if carried is set.
+ */
+static int check_output(const char* label, const char* name,
+			const char* ip, int carried, long long stamp){
+
+    FILE* fp;
+    char line[LINE_SIZE];
+    char* field;
+    char* resolved;
+    int found = 0;
+    int failures = 0;
+
+    if(!(fp = fopen(paths[OUTPUT], "r"))){
+	perror("error: reading output");
+	return 1;
+    }
+    while(!found && fgets(line, sizeof(line), fp)){
+	if(!(field = strchr(line, ',')) ||
+	   !(resolved = strchr(field + 1, ','))){
+	    continue;
+	}
+	*field++ = '\0';
+	*resolved++ = '\0';
+	if(strcmp(line, name)){
+	    continue;
+	}
+	found = 1;
+	if(strcmp(field, ip)){
+	    fprintf(stderr,
+		    "error: %s: %s gave %s, expected %s\n",
+		    label, name, field, ip);
+	    failures++;
+	}
+	else if(carried && atoll(resolved) != stamp){
+	    fprintf(stderr,
+		    "error: %s: %s was looked up again\n",
+		    label, name);
+	    failures++;
+	}
+    }
+    fclose(fp);
+    if(!found){
+	fprintf(stderr,
+		"error: %s: %s missing from the output\n", label, name);
+	failures++;
+    }
+    return failures;
+}
+
+/*
+ * Checks that the change report has the given line.
+ */
+static int check_report(const char* label, const char* expected){
+
+    FILE* fp;
+    char line[LINE_SIZE];
+    int found = 0;
+
+    if(!(fp = fopen(paths[REPORT], "r"))){
+	perror("error: reading report");
+	return 1;
+    }
+    while(!found && fgets(line, sizeof(line), fp)){
+	line[strcspn(line, "\n")] = '\0';
+	found = !strcmp(line, expected);
+    }
+    fclose(fp);
+    if(!found){
+	fprintf(stderr,
+		"error: %s: report is missing \"%s\"\n", label, expected);
+    }
+    return !found;
+}
+
+int main(int argc, char* argv[]){
+
+    /* Void Unused Variables */
+    (void) argc;
+    (void) argv;
+
+    /* Setup local vars */
+    char text[1024];
+    long long stamp = (long long)time(NULL) - 60;
+    size_t len = 0;
+    int fd;
+    int i;
+    int failures = 0;
+
+    for(i = 0; i < FILE_COUNT; i++){
+	snprintf(paths[i], PATH_SIZE, "/tmp/incrementalTest%dXXXXXX", i);
+	if((fd = mkstemp(paths[i])) < 0){
+	    perror("error: creating test file");
+	    while(i-- > 0){
+		unlink(paths[i]);
+	    }
+	    return EXIT_FAILURE;
+	}
+	close(fd);
+    }
+
+    /* A fresh previous answer for every name, and an input without
+     * the last one */
+    for(i = 0; i < PREVIOUS_COUNT; i++){
+	len += snprintf(text + len, sizeof(text) - len, "%s,%s,%lld\n",
+			previousNames[i], previousIps[i], stamp);
+    }
+    if(write_file(paths[PREVIOUS], text) ||
+       write_file(paths[INPUT], "a.example.com\nb.example.com\n") ||
+       write_file(paths[HOSTS], "10.9.9.1 a.example.com\n") ||
+       write_file(paths[TRACE],
+		  "a.example.com ok 10.8.8.1 0\n"
+		  "b.example.com ok 10.8.8.2 0\n")){
+	failures++;
+    }
+
+    /* The override answers a; b is still carried */
+    else if(run("--overrides", paths[HOSTS]) != 0){
+	fprintf(stderr,
+		"error: --previous with --overrides failed\n");
+	failures++;
+    }
+    else{
+	failures += check_output("overrides", "a.example.com",
+				 "10.9.9.1", 0, stamp);
+	failures += check_output("overrides", "b.example.com",
+				 "10.0.0.2", 1, stamp);
+	failures += check_report("overrides",
+				 "changed a.example.com 10.0.0.1 10.9.9.1");
+	failures += check_report("overrides",
+				 "removed c.example.com 10.0.0.3");
+    }
+
+    /* The trace answers every name */
+    if(!failures && run("--replay", paths[TRACE]) != 0){
+	fprintf(stderr,
+		"error: --previous with --replay failed\n");
+	failures++;
+    }
+    else if(!failures){
+	failures += check_output("replay", "a.example.com",
+				 "10.8.8.1", 0, stamp);
+	failures += check_output("replay", "b.example.com",
+				 "10.8.8.2", 0, stamp);
+	failures += check_report("replay",
+				 "changed b.example.com 10.0.0.2 10.8.8.2");
+    }
+
+    for(i = 0; i < FILE_COUNT; i++){
+	unlink(paths[i]);
+    }
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
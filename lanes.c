@@ -0,0 +1,185 @@
+/*
+ * File: lanes.c
+ * Author: Domenic Murtari
+ * Project: CSCI 3753 Programming Assignment 2
+ * Description: Per-source lanes and the scheduler resolvers use to pick
+ *  between them. Weighted fairness uses stride scheduling: every lane has a
+ *  pass value that advances by LANE_STRIDE / weight for each name taken, and
+ *  the waiting lane with the smallest pass goes next.
+ *
+ */
+
+#include "lanes.h"
+
+int lanes_init(struct lane_set* set, const struct lookup_source* sources,
+               int count, int size, int policy, int timed){
+
+  struct lane* lane;
+  int i;
+
+  memset(set, 0, sizeof(*set));
+  set->policy = policy;
+  set->timed = timed;
+  if(!(set->lanes = calloc(count, sizeof(*set->lanes)))){
+    perror("Error Allocating Lanes");
+    return UTIL_FAILURE;
+  }
+
+  for(i = 0; i < count; i++){
+    lane = &set->lanes[i];
+    lane->source = &sources[i];
+    if(hostring_init(&lane->q, size) == RING_FAILURE)
+      goto fail;
+    if(sync_sem_init(&lane->empty, "empty", size)){
+      fprintf(stderr, "Error: empty Semaphore initialization failed\n");
+      hostring_cleanup(&lane->q);
+      goto fail;
+    }
+    set->count++;
+    if(timed && !(lane->stamps = malloc(size * sizeof(*lane->stamps)))){
+      perror("Error Allocating Lanes");
+      goto fail;
+    }
+  }
+  return UTIL_SUCCESS;
+
+ fail:
+  lanes_cleanup(set);
+  return UTIL_FAILURE;
+}
+
+int lanes_push(struct lane_set* set, struct lane* lane, const char* str,
+               size_t len, unsigned tag){
+
+  int slot = lane->q.rear;
+  int wasEmpty = hostring_is_empty(&lane->q);
+
+  if(hostring_push(&lane->q, str, len, tag) == RING_FAILURE)
+    return RING_FAILURE;
+
+  /* A lane that sat idle must not bank credit for the time it was empty, or
+   * it would starve the others when it comes back */
+  if(wasEmpty && lane->pass < set->vtime)
+    lane->pass = set->vtime;
+
+  if(set->timed){
+    lane->stamps[slot] = util_now_ns();
+    if(!lane->stats.firstNs)
+      lane->stats.firstNs = lane->stamps[slot];
+  }
+  set->queued++;
+  return RING_SUCCESS;
+}
+
+/*
+ * Returns the lane the policy serves next, or NULL if every lane is empty.
+ */
+static struct lane* lanes_pick(struct lane_set* set){
+
+  struct lane* best = NULL;
+  struct lane* lane;
+  int i;
+
+  for(i = 0; i < set->count; i++){
+    lane = &set->lanes[i];
+    if(hostring_is_empty(&lane->q))
+      continue;
+    if(best && set->policy == LANE_STRICT &&
+       lane->source->priority != best->source->priority){
+      if(lane->source->priority > best->source->priority)
+        best = lane;
+      continue;
+    }
+    if(!best || lane->pass < best->pass)
+      best = lane;
+  }
+  return best;
+}
+
+int lanes_pop(struct lane_set* set, char* str, size_t size, unsigned* tag,
+              struct lane** lane, long long* stamp){
+
+  struct lane* next = lanes_pick(set);
+  int slot;
+  int len;
+
+  if(!next)
+    return RING_FAILURE;
+  slot = next->q.front;
+  len = hostring_pop(&next->q, str, size, tag);
+
+  set->vtime = next->pass;
+  next->pass += LANE_STRIDE / next->source->weight;
+  set->queued--;
+
+  *lane = next;
+  *stamp = set->timed ? next->stamps[slot] : 0;
+  return len;
+}
+
+void lanes_done(struct lane* lane, long long stamp){
+
+  long long now;
+  unsigned long long latency;
+  unsigned long long max;
+
+  __atomic_add_fetch(&lane->stats.names, 1, __ATOMIC_RELAXED);
+  if(!stamp)
+    return;
+
+  now = util_now_ns();
+  latency = now - stamp;
+  __atomic_add_fetch(&lane->stats.latencyNs, latency, __ATOMIC_RELAXED);
+  max = __atomic_load_n(&lane->stats.maxLatencyNs, __ATOMIC_RELAXED);
+  while(latency > max &&
+        !__atomic_compare_exchange_n(&lane->stats.maxLatencyNs, &max, latency,
+                                     1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+  __atomic_store_n(&lane->stats.lastNs, now, __ATOMIC_RELAXED);
+}
+
+void lanes_report(const struct lane_set* set, FILE* fp){
+
+  const struct lane* lane;
+  const struct lane_stats* stats;
+  double seconds;
+  char label[32];
+  int header = 0;
+  int i;
+
+  fprintf(fp, "%-4s %8s %6s %10s %10s %10s %10s  %s\n", "Lane", "Priority",
+          "Weight", "Names", "Mean ms", "Max ms", "Names/s", "Source");
+  for(i = 0; i < set->count; i++){
+    lane = &set->lanes[i];
+    stats = &lane->stats;
+    seconds = (stats->lastNs - stats->firstNs) / 1e9;
+    if(!lane->source->path)
+      snprintf(label, sizeof(label), "shard %d", lane->source->shard);
+    fprintf(fp, "%-4d %8d %6d %10llu %10.3f %10.3f %10.0f  %s\n", i,
+            lane->source->priority, lane->source->weight, stats->names,
+            stats->names ? stats->latencyNs / 1e6 / stats->names : 0.0,
+            stats->maxLatencyNs / 1e6,
+            seconds > 0 ? stats->names / seconds : 0.0,
+            lane->source->path ? lane->source->path : label);
+  }
+
+  for(i = 0; i < set->count; i++){
+    lane = &set->lanes[i];
+    fileio_decode_report(fp, "Lane", i, &lane->decoded, lane->source->path,
+                         &header);
+  }
+}
+
+void lanes_cleanup(struct lane_set* set){
+
+  int i;
+
+  for(i = 0; i < set->count; i++){
+    if(sync_sem_destroy(&set->lanes[i].empty))
+      fprintf(stderr, "Error: Destroying empty semaphore failed\n");
+    hostring_cleanup(&set->lanes[i].q);
+    free(set->lanes[i].stamps);
+  }
+  free(set->lanes);
+  set->lanes = NULL;
+  set->count = 0;
+}
@@ -0,0 +1,89 @@
+/*
+ * File: lanes.h
+ * Author: Domenic Murtari
+ * Project: CSCI 3753 Programming Assignment 2
+ * Description: Declarations for the per-source queues between requesters and
+ *  resolvers. Each input source gets its own lane: a hostring and its own
+ *  count of free slots, so a large file can only fill its own lane. Resolvers
+ *  pick which lane to take the next name from with one of two policies:
+ *
+ *    LANE_WFQ     weighted fair: over time each busy lane gets a share of
+ *                 the resolvers proportional to its weight
+ *    LANE_STRICT  strict priority: always a waiting lane with the highest
+ *                 priority, weighted fair among equal priorities
+ *
+ *  All lane state is protected by the caller's queue mutex except the
+ *  statistics, which resolvers update with atomics.
+ *
+ */
+
+#ifndef LANES_H
+#define LANES_H
+
+#include "multi-lookup.h"
+#include "fileio.h"
+#include "syncprof.h"
+
+#define LANE_WFQ 0
+#define LANE_STRICT 1
+
+/* Virtual time a lane with weight 1 is charged per name */
+#define LANE_STRIDE (1 << 20)
+#define MAX_LANE_WEIGHT 1000
+#define MAX_LANE_PRIORITY 99
+
+struct lane_stats{
+  unsigned long long names;     // Names resolved from this lane
+  unsigned long long latencyNs; // Total time from enqueue to result written
+  unsigned long long maxLatencyNs;
+  long long firstNs;            // First enqueue
+  long long lastNs;             // Last result written
+};
+
+struct lane{
+  hostring q;
+  sync_sem empty;           // Free slots in q
+  long long* stamps;        // Enqueue time of each slot, when timing
+  const struct lookup_source* source; // Priority, weight and label
+  unsigned long long pass;  // Virtual time of the lane's next name
+  struct lane_stats stats;
+  fileio_decode_stats decoded; // Set by the requester for compressed input
+};
+
+struct lane_set{
+  struct lane* lanes;
+  int count;
+  int policy;
+  int timed;                // Record enqueue times for the statistics
+  int queued;               // Names waiting across all lanes
+  unsigned long long vtime; // Pass of the most recently served lane
+};
+
+/* Creates one lane of the given size per source. Returns UTIL_SUCCESS or
+ * UTIL_FAILURE */
+int lanes_init(struct lane_set* set, const struct lookup_source* sources,
+               int count, int size, int policy, int timed);
+
+/* Appends a name to a lane. The caller holds the queue mutex and has taken a
+ * slot from the lane's empty semaphore. Returns RING_SUCCESS or
+ * RING_FAILURE */
+int lanes_push(struct lane_set* set, struct lane* lane, const char* str,
+               size_t len, unsigned tag);
+
+/* Takes the next name according to the policy. Stores the lane it came from
+ * in *lane and its enqueue time (0 when not timing) in *stamp. The caller
+ * holds the queue mutex. Returns the name length, or RING_FAILURE if every
+ * lane is empty */
+int lanes_pop(struct lane_set* set, char* str, size_t size, unsigned* tag,
+              struct lane** lane, long long* stamp);
+
+/* Records that a name taken from lane has been answered. No lock needed */
+void lanes_done(struct lane* lane, long long stamp);
+
+/* Prints the latency and throughput of each lane, and the decompression
+ * throughput of each compressed input */
+void lanes_report(const struct lane_set* set, FILE* fp);
+
+void lanes_cleanup(struct lane_set* set);
+
+#endif
@@ -0,0 +1,170 @@
+/*
+ * File: lanesTest.c
+ * Author: Domenic Murtari
+ * Project: CSCI 3753 Programming Assignment 2
+ * Description:
+ * 	This file contains test code for the lane scheduler. It
+ *      checks the weighted fair share, strict priority order,
+ *      and that an idle lane does not bank credit.
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include "lanes.h"
+#include "probes.h"
+
+PROBE_DEFINE_SEMAPHORES
+
+#define LANE_SIZE 512
+#define WFQ_POPS 500
+
+/*
+ * Sets up two lanes with the given priorities and weights.
+ */
+static int setup(struct lane_set* set, struct lookup_source* sources,
+		 int policy, int priority0, int weight0,
+		 int priority1, int weight1){
+
+    memset(sources, 0, 2 * sizeof(*sources));
+    sources[0].path = "lane0";
+    sources[0].priority = priority0;
+    sources[0].weight = weight0;
+    sources[1].path = "lane1";
+    sources[1].priority = priority1;
+    sources[1].weight = weight1;
+    if(lanes_init(set, sources, 2, LANE_SIZE, policy, 0)
+       == UTIL_FAILURE){
+	fprintf(stderr,
+		"error: lanes_init failed!\n");
+	return UTIL_FAILURE;
+    }
+    return UTIL_SUCCESS;
+}
+
+/*
+ * Pushes count names into a lane.
+ */
+static int fill(struct lane_set* set, int lane, int count){
+
+    char name[32];
+    int i;
+
+    for(i = 0; i < count; i++){
+	snprintf(name, sizeof(name), "host%d.lane%d", i, lane);
+	if(lanes_push(set, &set->lanes[lane], name, strlen(name), i)
+	   == RING_FAILURE){
+	    fprintf(stderr,
+		    "error: lanes_push to lane %d failed\n", lane);
+	    return UTIL_FAILURE;
+	}
+    }
+    return UTIL_SUCCESS;
+}
+
+/*
+ * Pops count names and adds up how many came from each lane.
+ */
+static int drain(struct lane_set* set, int count, int served[2]){
+
+    char name[MAX_NAME_LENGTH];
+    struct lane* from;
+    long long stamp;
+    unsigned tag;
+    int i;
+
+    served[0] = served[1] = 0;
+    for(i = 0; i < count; i++){
+	if(lanes_pop(set, name, sizeof(name), &tag, &from, &stamp)
+	   == RING_FAILURE){
+	    fprintf(stderr,
+		    "error: lanes_pop failed after %d names\n", i);
+	    return UTIL_FAILURE;
+	}
+	served[from - set->lanes]++;
+    }
+    return UTIL_SUCCESS;
+}
+
+int main(int argc, char* argv[]){
+
+    /* Void Unused Variables */
+    (void) argc;
+    (void) argv;
+
+    /* Setup local vars */
+    struct lane_set set;
+    struct lookup_source sources[2];
+    int served[2];
+    int failures = 0;
+
+    /* Weights 1 and 4 share the resolvers about 1:4 */
+    if(setup(&set, sources, LANE_WFQ, 0, 1, 0, 4) == UTIL_FAILURE ||
+       fill(&set, 0, LANE_SIZE) == UTIL_FAILURE ||
+       fill(&set, 1, LANE_SIZE) == UTIL_FAILURE ||
+       drain(&set, WFQ_POPS, served) == UTIL_FAILURE){
+	return EXIT_FAILURE;
+    }
+    if(served[1] < 3.8 * served[0] || served[1] > 4.2 * served[0]){
+	fprintf(stderr,
+		"error: weights 1:4 served %d:%d\n",
+		served[0], served[1]);
+	failures++;
+    }
+    lanes_cleanup(&set);
+
+    /* Strict priority drains the higher priority lane first,
+     * whatever the weights */
+    if(setup(&set, sources, LANE_STRICT, 0, 4, 5, 1) == UTIL_FAILURE ||
+       fill(&set, 0, 100) == UTIL_FAILURE ||
+       fill(&set, 1, 100) == UTIL_FAILURE ||
+       drain(&set, 100, served) == UTIL_FAILURE){
+	return EXIT_FAILURE;
+    }
+    if(served[1] != 100){
+	fprintf(stderr,
+		"error: strict priority served the low lane "
+		"%d times before the high lane was empty\n",
+		served[0]);
+	failures++;
+    }
+    if(drain(&set, 100, served) == UTIL_FAILURE){
+	return EXIT_FAILURE;
+    }
+    if(served[0] != 100){
+	fprintf(stderr,
+		"error: strict priority did not drain the low lane\n");
+	failures++;
+    }
+    lanes_cleanup(&set);
+
+    /* A lane that sat idle while the other was served starts at
+     * the current virtual time, not with banked credit */
+    if(setup(&set, sources, LANE_WFQ, 0, 1, 0, 1) == UTIL_FAILURE ||
+       fill(&set, 0, 200) == UTIL_FAILURE ||
+       drain(&set, 100, served) == UTIL_FAILURE ||
+       fill(&set, 1, 100) == UTIL_FAILURE){
+	return EXIT_FAILURE;
+    }
+    if(set.lanes[1].pass != set.vtime){
+	fprintf(stderr,
+		"error: idle lane pass %llu, expected vtime %llu\n",
+		set.lanes[1].pass, set.vtime);
+	failures++;
+    }
+    if(drain(&set, 100, served) == UTIL_FAILURE){
+	return EXIT_FAILURE;
+    }
+    if(served[0] < 49 || served[0] > 51){
+	fprintf(stderr,
+		"error: after an idle period equal weights "
+		"served %d:%d\n", served[0], served[1]);
+	failures++;
+    }
+    lanes_cleanup(&set);
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
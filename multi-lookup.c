@@ -5,95 +5,246 @@
  * Create Date: 2/23/2014
  * Modify Date: 2/27/2014
  * Description: Contains a multi-thread implementation of the DNS Lookup system
- * 
- * References: 
+ *
+ * References:
  *  http://jlmedina123.wordpress.com/2013/05/03/pthreads-with-mutex-and-semaphores/
- * 
+ *
  */
 
-#include "multi-lookup.h"
+#include <getopt.h>
 
-FILE* outputfp;             // Pointer to the output file
-queue q;                    // Queue to store hostnames in
+#include "multi-lookup.h"
+#include "autotune.h"
+#include "fileio.h"
+#include "incremental.h"
+#include "lanes.h"
+#include "override.h"
+#include "replay.h"
+#include "shard.h"
+#include "probes.h"
+#include "syncprof.h"
+
+PROBE_DEFINE_SEMAPHORES
+
+fileio_writer output;       // Buffered writer for the output file
+struct shard_table* resultTable = NULL; // Where shard workers store results
+struct inc_index* previous = NULL; // Previous results in incremental mode
+struct override_table* overrides = NULL; // Names answered without DNS
+struct replay_trace* replay = NULL; // Recorded answers used instead of DNS
+fileio_writer trace;        // Buffered writer for the lookup trace
+int recording = 0;          // Write every lookup to the trace
+struct lane_set lanes;      // One ring per source to pass hostnames in
+int showStats = 0;          // Print per-lane statistics after each run
 int runningRequesters = 0;  // Count of the number of running requesters threads
+int resolverCount = 0;      // Number of resolver threads in the current run
+int batchSize = BATCH_SIZE; // Max names a resolver takes per queue lock
 
 /* Mutexes to control access to shared resources */
-pthread_mutex_t queueMutex;     // Mutex for access to the queue
-pthread_mutex_t outputMutex;    // Mutex for access to the output file
-pthread_mutex_t requesterMutex; // Mutex for the running requesters thread count
+sync_mutex queueMutex;     // Mutex for access to the queue
+sync_mutex outputMutex;    // Mutex for access to the output file
+sync_mutex requesterMutex; // Mutex for the running requesters thread count
+sync_mutex traceMutex;     // Mutex for access to the trace file
+
+/* Semaphore to see if there is something in any lane. Each lane counts its
+ * own empty spaces */
+sync_sem full;
+
+/* Long-only command line options */
+enum{
+  OPT_AUTOTUNE = 256,
+  OPT_AUTOTUNE_SAMPLE,
+  OPT_PROFILE,
+  OPT_IO_URING,
+  OPT_ORDERED,
+  OPT_PREVIOUS,
+  OPT_MAX_AGE,
+  OPT_REPORT,
+  OPT_SCHED,
+  OPT_STATS,
+  OPT_OVERRIDES,
+  OPT_OVERRIDES_COMPILE,
+  OPT_RECORD,
+  OPT_REPLAY,
+  OPT_REPLAY_SCALE
+};
+
+static const struct option longOptions[] = {
+  {"queue-size",      required_argument, NULL, 'q'},
+  {"threads",         required_argument, NULL, 't'},
+  {"max-threads",     required_argument, NULL, 'm'},
+  {"batch-size",      required_argument, NULL, 'b'},
+  {"autotune",        no_argument,       NULL, OPT_AUTOTUNE},
+  {"autotune-sample", required_argument, NULL, OPT_AUTOTUNE_SAMPLE},
+  {"profile",         required_argument, NULL, OPT_PROFILE},
+  {"io-uring",        no_argument,       NULL, OPT_IO_URING},
+  {"processes",       required_argument, NULL, 'p'},
+  {"ordered",         no_argument,       NULL, OPT_ORDERED},
+  {"previous",        required_argument, NULL, OPT_PREVIOUS},
+  {"max-age",         required_argument, NULL, OPT_MAX_AGE},
+  {"report",          required_argument, NULL, OPT_REPORT},
+  {"sched",           required_argument, NULL, OPT_SCHED},
+  {"stats",           no_argument,       NULL, OPT_STATS},
+  {"overrides",       required_argument, NULL, OPT_OVERRIDES},
+  {"overrides-compile", required_argument, NULL, OPT_OVERRIDES_COMPILE},
+  {"record",          required_argument, NULL, OPT_RECORD},
+  {"replay",          required_argument, NULL, OPT_REPLAY},
+  {"replay-scale",    required_argument, NULL, OPT_REPLAY_SCALE},
+  {NULL, 0, NULL, 0}
+};
+
+/*
+ * Inserts one hostname and its tag into a lane, waiting for an empty slot.
+ * Waits for a random length of time if the lane is full.
+ */
+static void enqueue(struct lane* lane, const char* hostname, size_t len,
+                    unsigned tag){
+
+  struct timespec reqtime;
+
+  /* Wait until there is an empty slot in this lane */
+  sync_sem_wait(&lane->empty);
+
+  /* Acquire queue mutex lock so other requesters can't insert at same time
+   * and resolvers can't try to read from the queue */
+  sync_mutex_lock(&queueMutex);
+
+  /* Copy the name into the queue. If the queue is full and returns failure,
+   * sleep and try again after a random time */
+  while(lanes_push(&lanes, lane, hostname, len, tag) == RING_FAILURE){
+    sync_mutex_unlock(&queueMutex);
+    reqtime.tv_sec = 0;
+    reqtime.tv_nsec = rand() % 100;
+    nanosleep(&reqtime, NULL);
+    sync_mutex_lock(&queueMutex);
+  }
+  PROBE_ENQUEUE(hostname, lanes.queued);
+
+  /* Unlock queue and signal that there is something in the queue */
+  sync_mutex_unlock(&queueMutex);
+  sync_sem_post(&full);
+}
 
-/* Semaphores to communicate between threads */
-sem_t full;   // Semaphore to see if there is something in the queue
-sem_t empty;  // Semaphore to count the number of empty spaces in queue
+/*
+ * Copies a still fresh previous answer straight to the output, keeping the
+ * time it was resolved.
+ */
+static void carry_previous(const char* hostname, const struct inc_entry* entry){
+
+  char line[MAX_NAME_LENGTH + INET6_ADDRSTRLEN + 24];
+
+  PROBE_CACHE_HIT(hostname, entry->ip);
+  sync_mutex_lock(&outputMutex);
+  fileio_write(&output, line, snprintf(line, sizeof(line), "%s,%s,%lld\n",
+                                       hostname, entry->ip,
+                                       (long long)entry->stamp));
+  sync_mutex_unlock(&outputMutex);
+}
 
 /*
- * Function for the requester threads. Takes a pointer to a file as input, and 
- * goes through that file inserting hostnames into the queue. Waits for a 
- * random length of time if the queue is full.
+ * Function for the requester threads. Takes a pointer to the lane of a lookup
+ * source as input, and goes through that file, or the unfinished names of
+ * that shard, inserting hostnames into the lane. Shard names are tagged with their
+ * index in the shared table so resolvers know where to store the result.
+ * In incremental mode, names with a fresh previous answer skip the queue,
+ * unless the override table or a replayed trace answers them.
  */
-void* requester(void* fileName){
-    
-  FILE* inputfp;
+void* requester(void* arg){
+
+  struct lane* lane = arg;
+  const struct lookup_source* source = lane->source;
+  fileio_reader input;
   char errorstr[SBUFSIZE];
   char hostname[MAX_NAME_LENGTH];
-  char* payload;
-  struct timespec reqtime;
-  
-  /* Open the input file for import */  
-  inputfp = fopen(fileName, "r");
-  if(!inputfp){
-    sprintf(errorstr, "Error Opening Input File: %p", fileName);
-    perror(errorstr);
-  }
+  const char* name;
+  struct inc_entry* entry;
+  int opened = 0;
+  int ret = 0;
+  size_t n;
+  int i;
 
-  /* Go through the input file, inserting hostnames into the queue */
-  while(fscanf(inputfp, INPUTFS, hostname) > 0){
-    
-    /* Wait until there is an empty slot in the queue */
-    sem_wait(&empty);
-
-    /* Allocate memory for payload and copy to array */
-    payload = (char*)malloc(sizeof(hostname));
-    strcpy(payload, hostname);
-
-    /* Acquire queue mutex lock so other requesters can't insert at same time 
-     * and resolvers can't try to read from the queue */
-    pthread_mutex_lock(&queueMutex);
-
-    /* Add an item to the queue. If the queue is full and returns failure, sleep
-     * and try again after a random time */
-    while(queue_push(&q, (void*)payload) == QUEUE_FAILURE){
-      pthread_mutex_unlock(&queueMutex);
-      reqtime.tv_sec = 0;
-      reqtime.tv_nsec = rand() % 100;
-      nanosleep(&reqtime, NULL);
-      pthread_mutex_lock(&queueMutex);
+  if(source->table){
+    /* Go through this shard's names, skipping any a previous attempt at the
+     * shard already resolved */
+    for(n = 0; n < source->table->count; n++){
+      if(source->table->entries[n].shard != (unsigned)source->shard ||
+         shard_is_done(source->table, n))
+        continue;
+      name = shard_name(source->table, n);
+      enqueue(lane, name, strlen(name), n);
+    }
+  }
+  else{
+    /* Open the input file for import */
+    opened = fileio_reader_open(&input, source->path) == FILEIO_SUCCESS;
+    if(!opened){
+      snprintf(errorstr, sizeof(errorstr), "Error Opening Input File: %s",
+               source->path);
+      perror(errorstr);
     }
 
-    /* Unlock queue and signal that there is something in the queue */
-    pthread_mutex_unlock(&queueMutex);
-    sem_post(&full);
+    /* Go through the input file, inserting hostnames into the queue */
+    while(opened && (ret = fileio_read_name(&input, hostname,
+                                            sizeof(hostname))) > 0){
+      /* Overridden and replayed names always go to the resolvers, so their
+       * answers come from the same place as in a full run */
+      if(previous){
+        entry = inc_find(previous, hostname);
+        if(!replay && !(overrides && override_find(overrides, hostname)) &&
+           inc_use_previous(previous, entry)){
+          carry_previous(hostname, entry);
+          continue;
+        }
+      }
+      enqueue(lane, hostname, strlen(hostname), 0);
+    }
   }
-  
+
   /* Done processing file, so requester thread will terminate. Make sure that no
-   * other requestors can access the counting variable at the same time */
-  pthread_mutex_lock(&requesterMutex);
+   * other requestors can access the counting variable at the same time. The
+   * last requester out wakes every resolver so none stays blocked on full */
+  sync_mutex_lock(&requesterMutex);
   runningRequesters--;
-  pthread_mutex_unlock(&requesterMutex);
+  if(runningRequesters == 0){
+    for(i = 0; i < resolverCount; i++)
+      sync_sem_post(&full);
+  }
+  sync_mutex_unlock(&requesterMutex);
 
   /* Close input file and return */
-  fclose(inputfp);  
+  if(ret < 0){
+    snprintf(errorstr, sizeof(errorstr), "Error Reading Input File: %s",
+             source->path);
+    perror(errorstr);
+  }
+  if(opened){
+    fileio_reader_close(&input);
+    lane->decoded = input.decoded;
+  }
   return NULL;
-}   
-    
+}
+
 /*
- * Function for the resolver threads. Reads from the queue that the requesters
+ * Function for the resolver threads. Reads from the lanes that the requesters
  * populate, looking up the hostname and writing the result to the output file.
+ * Takes up to batchSize names per trip through the queue lock, each from the
+ * lane the scheduling policy picks.
  */
 void* resolver(){
-    
-  char* hostname;
-  char firstipstr[INET6_ADDRSTRLEN];
+
+  char hostnames[batchSize][MAX_NAME_LENGTH];
+  char firstipstrs[batchSize][INET6_ADDRSTRLEN];
+  char line[MAX_NAME_LENGTH + INET6_ADDRSTRLEN + 24];
+  int statuses[batchSize];
+  long long latencies[batchSize]; // Lookup times to record, -1 if no lookup
+  unsigned tags[batchSize];
+  struct lane* from[batchSize];
+  long long stamps[batchSize];
+  long long now;
+  const char* known;
+  long long started = 0;
+  int count;
+  int ok;
+  int i;
 
   /* While there are still requesters running and there are still items in the
    * queue, try to read items from the queue and resolve the hostnames */
@@ -103,129 +254,209 @@ void* resolver(){
      * waiting to complete. Need to control access to the queue and the count
      * of running requesters to do this. If the queue is empty and no requesters
      * are running, exit the while loop */
-    pthread_mutex_lock(&queueMutex);
-    pthread_mutex_lock(&requesterMutex);
-    if(queue_is_empty(&q) && (runningRequesters == 0)){
-      pthread_mutex_unlock(&queueMutex);
-      pthread_mutex_unlock(&requesterMutex);
+    sync_mutex_lock(&queueMutex);
+    sync_mutex_lock(&requesterMutex);
+    if(lanes.queued == 0 && (runningRequesters == 0)){
+      sync_mutex_unlock(&queueMutex);
+      sync_mutex_unlock(&requesterMutex);
       break;
     }
 
     /* Unlock mutexes in case this thread has to wait on full */
-    pthread_mutex_unlock(&queueMutex);
-    pthread_mutex_unlock(&requesterMutex);
-
-    /* Wait for there to be something in the queue */
-    sem_wait(&full);
-
-    /* There is something in the queue, so read a name from the queue */
-    pthread_mutex_lock(&queueMutex);
-    hostname = (char*)queue_pop(&q);
-    pthread_mutex_unlock(&queueMutex);
+    sync_mutex_unlock(&queueMutex);
+    sync_mutex_unlock(&requesterMutex);
+
+    /* Wait for there to be something in the queue, then claim as many more
+     * items as are already waiting, up to the batch size */
+    sync_sem_wait(&full);
+    count = 1;
+    while(count < batchSize && sync_sem_trywait(&full) == 0)
+      count++;
+
+    /* Read the claimed names from the queue. A wakeup from the last requester
+     * finds the queue empty, so stop at the first failure and hand the unused
+     * claims back for the other resolvers to wake on */
+    sync_mutex_lock(&queueMutex);
+    for(i = 0; i < count; i++){
+      if(lanes_pop(&lanes, hostnames[i], sizeof(hostnames[i]), &tags[i],
+                   &from[i], &stamps[i]) == RING_FAILURE)
+        break;
+      PROBE_DEQUEUE(hostnames[i], lanes.queued);
+    }
+    sync_mutex_unlock(&queueMutex);
+    for(; count > i; count--)
+      sync_sem_post(&full);
+
+    /* Signal that there is room in the lanes the names came from */
+    for(i = 0; i < count; i++)
+      sync_sem_post(&from[i]->empty);
+
+    /* Lookup hostnames, unless the override table has them */
+    for(i = 0; i < count; i++){
+      latencies[i] = -1;
+      if(overrides && (known = override_find(overrides, hostnames[i]))){
+        strncpy(firstipstrs[i], known, sizeof(firstipstrs[i]));
+        PROBE_CACHE_HIT(hostnames[i], firstipstrs[i]);
+        continue;
+      }
+      if(recording || PROBE_ENABLED(lookup__end))
+        started = util_now_ns();
+      PROBE_LOOKUP_START(hostnames[i]);
+      if(replay)
+        ok = replay_lookup(replay, hostnames[i], firstipstrs[i],
+                           sizeof(firstipstrs[i]), &statuses[i])
+          != UTIL_FAILURE;
+      else
+        ok = dnslookup_status(hostnames[i], firstipstrs[i],
+                              sizeof(firstipstrs[i]), &statuses[i])
+          != UTIL_FAILURE;
+      if(recording)
+        latencies[i] = util_now_ns() - started;
+      if(!ok){
+        fprintf(stderr, "dnslookup error: %s\n", hostnames[i]);
+        strncpy(firstipstrs[i], "", sizeof(firstipstrs[i]));
+      }
+      PROBE_LOOKUP_END(hostnames[i], firstipstrs[i],
+                       PROBE_ENABLED(lookup__end) ?
+                       util_now_ns() - started : 0, ok);
+    }
 
-    /* Signal that there is room in the queue */
-    sem_post(&empty);
+    /* Record how each lookup went, for a later --replay */
+    if(recording){
+      sync_mutex_lock(&traceMutex);
+      for(i = 0; i < count; i++){
+        if(latencies[i] < 0)
+          continue;
+        fileio_write(&trace, line, snprintf(line, sizeof(line),
+                                            "%s %s %s %lld\n", hostnames[i],
+                                            replay_class(statuses[i]),
+                                            firstipstrs[i][0] ?
+                                            firstipstrs[i] : "-",
+                                            latencies[i]));
+      }
+      sync_mutex_unlock(&traceMutex);
+    }
 
-    /* Lookup hostname */
-    if(dnslookup(hostname, firstipstr, sizeof(firstipstr)) == UTIL_FAILURE){
-      fprintf(stderr, "dnslookup error: %s\n", hostname);
-      strncpy(firstipstr, "", sizeof(firstipstr));
+    /* Shard workers store results in the shared table, where each name has
+     * its own slot, so no lock is needed */
+    if(resultTable){
+      for(i = 0; i < count; i++){
+        shard_store(resultTable, tags[i], firstipstrs[i]);
+        lanes_done(from[i], stamps[i]);
+      }
+      continue;
     }
 
-    /* Write result to the output file. Need exclusive access to output */
-    pthread_mutex_lock(&outputMutex);
-    fprintf(outputfp, "%s,%s\n", hostname, firstipstr);
-    pthread_mutex_unlock(&outputMutex);
+    /* In incremental mode, compare against the previous answers and stamp
+     * each line with when it was resolved */
+    if(previous){
+      now = time(NULL);
+      for(i = 0; i < count; i++){
+        inc_record(previous, hostnames[i], inc_find(previous, hostnames[i]),
+                   firstipstrs[i]);
+      }
+      sync_mutex_lock(&outputMutex);
+      for(i = 0; i < count; i++){
+        fileio_write(&output, line, snprintf(line, sizeof(line),
+                                             "%s,%s,%lld\n", hostnames[i],
+                                             firstipstrs[i], now));
+      }
+      sync_mutex_unlock(&outputMutex);
+      for(i = 0; i < count; i++)
+        lanes_done(from[i], stamps[i]);
+      continue;
+    }
 
-    /* Free memory used by hostname */
-    free(hostname);
+    /* Write results to the output file. Need exclusive access to output */
+    sync_mutex_lock(&outputMutex);
+    for(i = 0; i < count; i++){
+      fileio_write(&output, line, snprintf(line, sizeof(line), "%s,%s\n",
+                                           hostnames[i], firstipstrs[i]));
+    }
+    sync_mutex_unlock(&outputMutex);
+    for(i = 0; i < count; i++)
+      lanes_done(from[i], stamps[i]);
   }
 
   return NULL;
 }
 
+long run_pipeline(const struct lookup_config* config,
+                  struct lookup_source* sources, int sourceCount,
+                  FILE* outputfp){
 
-int main(int argc, char* argv[]){
-    
   int i;
-  /* Number of requester threads is number of input files */
-  int requesterThreadCount = argc - 2;
-  /* Number of resolver threads is the number of cores */
-  int resolverThreadCount = sysconf( _SC_NPROCESSORS_ONLN ) * 2;
-  /* Set number of running requesters to the numbers of input files */
-  runningRequesters = requesterThreadCount;
+  /* Number of requester threads is number of sources */
+  int requesterThreadCount = sourceCount;
+  int resolverThreadCount = config->resolverThreads;
 
   /* Variables to keep track of execution time */
   struct timeval startTime;
   struct timeval endTime;
-  long elapsedTime;
-  
-  
-  /* Check Arguments */
-  if(argc < MINARGS){
-    fprintf(stderr, "Not enough arguments: %d\n", (argc - 1));
-    fprintf(stderr, "Usage:\n %s %s\n", argv[0], USAGE);
-    return EXIT_FAILURE;
-  }
-  if(resolverThreadCount < MIN_RESOLVER_THREADS){
-    fprintf(stderr, "Not enough resolver threads: %d\n", 
-            resolverThreadCount);
-    fprintf(stderr, "Requires %d threads", MIN_RESOLVER_THREADS);
-    return EXIT_FAILURE;
-  }
+  long elapsedTime = 0;
 
-  /* Open Output File */
-  outputfp = fopen(argv[(argc-1)], "w");
-    if(!outputfp){
-      perror("Error Opening Output File\n");
-      return EXIT_FAILURE;
+  /* Reset shared state for this run */
+  resultTable = sourceCount > 0 ? sources[0].table : NULL;
+  runningRequesters = requesterThreadCount;
+  resolverCount = resolverThreadCount;
+  batchSize = config->batchSize;
+
+  /* Create a lane per source, each the configured queue size */
+  if(lanes_init(&lanes, sources, sourceCount, config->queueSize,
+                config->policy, showStats) == UTIL_FAILURE){
+    fprintf(stderr,"Error: lanes_init failed!\n");
+    return -1;
   }
 
-  /* Create the queue, based on QUEUE_SIZE defined in header file */
-  if(queue_init(&q, QUEUE_SIZE) == QUEUE_FAILURE)
-    fprintf(stderr,"Error: queue_init failed!\n");
-
   /* Initialize mutexes */
-  if(pthread_mutex_init(&queueMutex, NULL)){
+  if(sync_mutex_init(&queueMutex, "queueMutex")){
     fprintf(stderr, "Error: queueMutex initialization failed\n");
-    return EXIT_FAILURE;
+    return -1;
   }
-  if(pthread_mutex_init(&outputMutex, NULL)){
+  if(sync_mutex_init(&outputMutex, "outputMutex")){
     fprintf(stderr, "Error: outputMutex initialization failed\n");
-    return EXIT_FAILURE;
+    return -1;
   }
-  if(pthread_mutex_init(&requesterMutex, NULL)){
+  if(sync_mutex_init(&requesterMutex, "requesterMutex")){
     fprintf(stderr, "Error: requesterMutex initialization failed\n");
-    return EXIT_FAILURE;
+    return -1;
+  }
+  if(sync_mutex_init(&traceMutex, "traceMutex")){
+    fprintf(stderr, "Error: traceMutex initialization failed\n");
+    return -1;
   }
 
   /* Initialize semaphores */
-  if(sem_init(&empty, 0, QUEUE_SIZE)){
-    fprintf(stderr, "Error: empty Semaphore initialization failed\n");
-    return EXIT_FAILURE;
-  }
-  if(sem_init(&full, 0, 0)){
+  if(sync_sem_init(&full, "full", 0)){
     fprintf(stderr, "Error: full Semaphore initialization failed\n");
+    return -1;
   }
 
   /* Current time before threads are spawned */
   gettimeofday(&startTime, NULL);
 
+  /* Start the output writer */
+  if(!resultTable && fileio_writer_open(&output, outputfp) == FILEIO_FAILURE){
+    fprintf(stderr, "Error: Opening output writer failed\n");
+    return -1;
+  }
+
   /* Create thread pools */
   pthread_t requesterThreads[requesterThreadCount];
   pthread_t resolverThreads[resolverThreadCount];
-  
+
   /* Populate thread pools with threads */
   for(i = 0; i < requesterThreadCount; i++){
-    if(pthread_create(&requesterThreads[i], NULL, requester, argv[i + 1])){
+    if(pthread_create(&requesterThreads[i], NULL, requester,
+                      &lanes.lanes[i])){
       fprintf(stderr, "Error: Creating requester threads failed\n");
-      return EXIT_FAILURE;
+      return -1;
     }
   }
   for(i = 0; i < resolverThreadCount; i++){
     if(pthread_create(&resolverThreads[i], NULL, resolver, NULL)){
       fprintf(stderr, "Error: Creating resolver threads failed\n");
-      return EXIT_FAILURE;
+      return -1;
     }
   }
 
@@ -240,28 +471,423 @@ int main(int argc, char* argv[]){
       fprintf(stderr, "Error: Joining resolver thread %d failed\n", i);
     }
   }
-  
-  /* Time after threads are joined */
-  gettimeofday(&endTime, NULL);
 
-  /* Close Output File */
-  fclose(outputfp);
+  /* Flush the remaining output and stop the writer */
+  if(!resultTable && fileio_writer_close(&output) == FILEIO_FAILURE)
+    elapsedTime = -1;
+
+  /* Time after threads are joined and output is written */
+  gettimeofday(&endTime, NULL);
 
   /* Cleanup */
-  if(pthread_mutex_destroy(&queueMutex))
+  if(sync_mutex_destroy(&queueMutex))
     fprintf(stderr, "Error: Destroying queueMutex failed\n");
-  if(pthread_mutex_destroy(&outputMutex))
+  if(sync_mutex_destroy(&outputMutex))
     fprintf(stderr, "Error: Destroying outputMutex failed\n");
-  if(pthread_mutex_destroy(&requesterMutex))
+  if(sync_mutex_destroy(&requesterMutex))
     fprintf(stderr, "Error: Destroying requesterMutex failed\n");
-  if(sem_destroy(&full))
+  if(sync_mutex_destroy(&traceMutex))
+    fprintf(stderr, "Error: Destroying traceMutex failed\n");
+  if(sync_sem_destroy(&full))
     fprintf(stderr, "Error: Destroying full semaphore failed\n");
-  if(sem_destroy(&empty))
-    fprintf(stderr, "Error: Destroying empty semaphore failed\n");
-  queue_cleanup(&q);
+  if(showStats)
+    lanes_report(&lanes, stderr);
+  lanes_cleanup(&lanes);
+
+  /* Calculate the total elapsed time (in microseconds) */
+  if(elapsedTime < 0)
+    return -1;
+  elapsedTime = (endTime.tv_sec - startTime.tv_sec) * 1000000L +
+                (endTime.tv_usec - startTime.tv_usec);
+  return elapsedTime;
+}
+
+/*
+ * Parses a positive integer command line value. Returns UTIL_FAILURE and
+ * prints an error if the value is not a positive integer.
+ */
+static int parse_count(const char* name, const char* value, int* result){
+
+  char* end;
+  long parsed;
+
+  errno = 0;
+  parsed = strtol(value, &end, 10);
+  if(errno || *end != '\0' || parsed <= 0 || parsed > 1000000){
+    fprintf(stderr, "Invalid value for %s: %s\n", name, value);
+    return UTIL_FAILURE;
+  }
+  *result = (int)parsed;
+  return UTIL_SUCCESS;
+}
+
+/*
+ * Fills in a source from an input path argument, splitting off an optional
+ * "@PRIORITY[:WEIGHT]" suffix. A path that exists as given is never split.
+ * Returns UTIL_FAILURE and prints an error if the suffix is malformed.
+ */
+static int parse_source(char* arg, struct lookup_source* source){
+
+  char* at = strrchr(arg, '@');
+  char* end;
+  long priority;
+  long weight = 1;
+
+  source->path = arg;
+  source->table = NULL;
+  source->shard = 0;
+  source->priority = 0;
+  source->weight = 1;
+  if(!at || access(arg, F_OK) == 0)
+    return UTIL_SUCCESS;
+
+  errno = 0;
+  priority = strtol(at + 1, &end, 10);
+  if(errno || end == at + 1 || priority < 0 || priority > MAX_LANE_PRIORITY ||
+     (*end != '\0' && *end != ':')){
+    fprintf(stderr, "Invalid priority for %s (expected 0 to %d)\n", arg,
+            MAX_LANE_PRIORITY);
+    return UTIL_FAILURE;
+  }
+  if(*end == ':'){
+    weight = strtol(end + 1, &end, 10);
+    if(errno || *end != '\0' || weight < 1 || weight > MAX_LANE_WEIGHT){
+      fprintf(stderr, "Invalid weight for %s (expected 1 to %d)\n", arg,
+              MAX_LANE_WEIGHT);
+      return UTIL_FAILURE;
+    }
+  }
+  source->priority = priority;
+  source->weight = weight;
+  *at = '\0';
+  return UTIL_SUCCESS;
+}
+
+int main(int argc, char* argv[]){
+
+  int opt;
+  int inputCount;
+  long elapsedTime;
+  int autotuneRun = 0;
+  int useUring = 0;
+  int processes = 0;
+  int ordered = 0;
+  int lanesGiven = 0;
+  int stats = 0;
+  int i;
+  int sampleSize = AUTOTUNE_SAMPLE;
+  int maxAge = INC_MAX_AGE;
+  const char* profilePath = PROFILE_PATH;
+  const char* previousPath = NULL;
+  const char* reportPath = NULL;
+  const char* overridePath = NULL;
+  const char* imagePath = NULL;
+  const char* recordPath = NULL;
+  const char* replayPath = NULL;
+  double replayScale = 1.0;
+  char* end;
+  struct override_table overrideTable;
+  struct replay_trace replayTrace;
+  struct inc_index index;
+  FILE* reportfp = NULL;
+  FILE* tracefp = NULL;
+  FILE* outputfp;
+
+  /* Values given on the command line, 0 when not given */
+  int queueSize = 0;
+  int resolverThreads = 0;
+  int maxResolverThreads = 0;
+  int batch = 0;
+
+  /* Defaults: number of resolver threads is twice the number of cores */
+  struct lookup_config config;
+  config.queueSize = QUEUE_SIZE;
+  config.resolverThreads = sysconf( _SC_NPROCESSORS_ONLN ) * 2;
+  config.maxResolverThreads = MAX_RESOLVER_THREADS;
+  config.batchSize = BATCH_SIZE;
+  config.policy = LANE_WFQ;
+
+  /* Parse options */
+  while((opt = getopt_long(argc, argv, "q:t:m:b:p:", longOptions, NULL))
+        != -1){
+    switch(opt){
+    case 'q':
+      if(parse_count("--queue-size", optarg, &queueSize) == UTIL_FAILURE)
+        return EXIT_FAILURE;
+      if(queueSize > MAX_QUEUE_SIZE){
+        fprintf(stderr, "Queue size %d exceeds maximum of %d\n", queueSize,
+                MAX_QUEUE_SIZE);
+        return EXIT_FAILURE;
+      }
+      break;
+    case 't':
+      if(parse_count("--threads", optarg, &resolverThreads) == UTIL_FAILURE)
+        return EXIT_FAILURE;
+      break;
+    case 'm':
+      if(parse_count("--max-threads", optarg, &maxResolverThreads)
+         == UTIL_FAILURE)
+        return EXIT_FAILURE;
+      if(maxResolverThreads > RESOLVER_THREAD_LIMIT){
+        fprintf(stderr, "Max thread count %d exceeds maximum of %d\n",
+                maxResolverThreads, RESOLVER_THREAD_LIMIT);
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'b':
+      if(parse_count("--batch-size", optarg, &batch) == UTIL_FAILURE)
+        return EXIT_FAILURE;
+      if(batch > MAX_BATCH_SIZE){
+        fprintf(stderr, "Batch size %d exceeds maximum of %d\n", batch,
+                MAX_BATCH_SIZE);
+        return EXIT_FAILURE;
+      }
+      break;
+    case OPT_AUTOTUNE:
+      autotuneRun = 1;
+      break;
+    case OPT_AUTOTUNE_SAMPLE:
+      if(parse_count("--autotune-sample", optarg, &sampleSize)
+         == UTIL_FAILURE)
+        return EXIT_FAILURE;
+      break;
+    case OPT_PROFILE:
+      profilePath = optarg;
+      break;
+    case OPT_IO_URING:
+      useUring = 1;
+      break;
+    case 'p':
+      if(parse_count("--processes", optarg, &processes) == UTIL_FAILURE)
+        return EXIT_FAILURE;
+      if(processes > MAX_PROCESSES){
+        fprintf(stderr, "Process count %d exceeds maximum of %d\n",
+                processes, MAX_PROCESSES);
+        return EXIT_FAILURE;
+      }
+      break;
+    case OPT_ORDERED:
+      ordered = 1;
+      break;
+    case OPT_PREVIOUS:
+      previousPath = optarg;
+      break;
+    case OPT_MAX_AGE:
+      if(parse_count("--max-age", optarg, &maxAge) == UTIL_FAILURE)
+        return EXIT_FAILURE;
+      break;
+    case OPT_REPORT:
+      reportPath = optarg;
+      break;
+    case OPT_SCHED:
+      if(!strcmp(optarg, "wfq"))
+        config.policy = LANE_WFQ;
+      else if(!strcmp(optarg, "strict"))
+        config.policy = LANE_STRICT;
+      else{
+        fprintf(stderr, "Invalid value for --sched: %s\n", optarg);
+        return EXIT_FAILURE;
+      }
+      break;
+    case OPT_STATS:
+      stats = 1;
+      break;
+    case OPT_OVERRIDES:
+      overridePath = optarg;
+      break;
+    case OPT_OVERRIDES_COMPILE:
+      imagePath = optarg;
+      break;
+    case OPT_RECORD:
+      recordPath = optarg;
+      break;
+    case OPT_REPLAY:
+      replayPath = optarg;
+      break;
+    case OPT_REPLAY_SCALE:
+      errno = 0;
+      replayScale = strtod(optarg, &end);
+      if(errno || end == optarg || *end != '\0' || !(replayScale >= 0) ||
+         replayScale > MAX_REPLAY_SCALE){
+        fprintf(stderr, "Invalid value for --replay-scale: %s\n", optarg);
+        return EXIT_FAILURE;
+      }
+      break;
+    default:
+      fprintf(stderr, "Usage:\n %s %s\n", argv[0], USAGE);
+      return EXIT_FAILURE;
+    }
+  }
+
+  /* Load the override table. With --overrides-compile, just save it */
+  if(imagePath && !overridePath){
+    fprintf(stderr, "--overrides-compile requires --overrides\n");
+    return EXIT_FAILURE;
+  }
+  if(overridePath){
+    if(override_load(&overrideTable, overridePath) == UTIL_FAILURE)
+      return EXIT_FAILURE;
+    if(imagePath){
+      if(override_save(&overrideTable, imagePath) == UTIL_FAILURE)
+        return EXIT_FAILURE;
+      override_free(&overrideTable);
+      return EXIT_SUCCESS;
+    }
+    overrides = &overrideTable;
+  }
+
+  /* Check Arguments */
+  inputCount = argc - optind - 1;
+  if(inputCount < MINARGS - 2){
+    fprintf(stderr, "Not enough arguments: %d\n", (argc - optind));
+    fprintf(stderr, "Usage:\n %s %s\n", argv[0], USAGE);
+    return EXIT_FAILURE;
+  }
+
+  /* Split lane priorities and weights off the input paths */
+  struct lookup_source sources[inputCount];
+  for(i = 0; i < inputCount; i++){
+    if(parse_source(argv[optind + i], &sources[i]) == UTIL_FAILURE)
+      return EXIT_FAILURE;
+    if(sources[i].priority || sources[i].weight != 1)
+      lanesGiven = 1;
+  }
+  if(lanesGiven && (processes || ordered)){
+    fprintf(stderr, "Lane priorities cannot be combined with --processes or "
+            "--ordered\n");
+    return EXIT_FAILURE;
+  }
+  if(previousPath && (processes || ordered)){
+    fprintf(stderr, "--previous cannot be combined with --processes or "
+            "--ordered\n");
+    return EXIT_FAILURE;
+  }
+  if(reportPath && !previousPath){
+    fprintf(stderr, "--report requires --previous\n");
+    return EXIT_FAILURE;
+  }
+  if(recordPath && (processes || ordered)){
+    fprintf(stderr, "--record cannot be combined with --processes or "
+            "--ordered\n");
+    return EXIT_FAILURE;
+  }
+
+  /* Load the trace first so autotune trials replay it too */
+  if(replayPath){
+    if(replay_load(&replayTrace, replayPath, replayScale) == UTIL_FAILURE)
+      return EXIT_FAILURE;
+    replay = &replayTrace;
+  }
+
+  /* Apply a saved profile, then let explicit flags override it */
+  if(!autotuneRun && profile_load(profilePath, &config) == UTIL_FAILURE)
+    return EXIT_FAILURE;
+  if(maxResolverThreads)
+    config.maxResolverThreads = maxResolverThreads;
+  if(config.resolverThreads > config.maxResolverThreads)
+    config.resolverThreads = config.maxResolverThreads;
+  if(queueSize)
+    config.queueSize = queueSize;
+  if(resolverThreads)
+    config.resolverThreads = resolverThreads;
+  if(batch)
+    config.batchSize = batch;
+
+  if(config.resolverThreads < MIN_RESOLVER_THREADS){
+    fprintf(stderr, "Not enough resolver threads: %d\n",
+            config.resolverThreads);
+    fprintf(stderr, "Requires %d threads\n", MIN_RESOLVER_THREADS);
+    return EXIT_FAILURE;
+  }
+  if(config.resolverThreads > config.maxResolverThreads){
+    fprintf(stderr, "Too many resolver threads: %d\n",
+            config.resolverThreads);
+    fprintf(stderr, "Maximum is %d threads\n", config.maxResolverThreads);
+    return EXIT_FAILURE;
+  }
+
+  /* Pick the I/O backend before any files are read */
+  fileio_init(useUring);
+
+  /* Search for the best parameters on a sample of the input and save them */
+  if(autotuneRun){
+    if(autotune(&config, &argv[optind], inputCount, sampleSize)
+       == UTIL_FAILURE){
+      fprintf(stderr, "Error: autotune failed\n");
+      return EXIT_FAILURE;
+    }
+    if(profile_save(profilePath, &config) == UTIL_FAILURE)
+      return EXIT_FAILURE;
+    /* Only report contention for the real run */
+    sync_reset("autotune trials excluded");
+  }
+  showStats = stats;
+
+  /* Start the trace after autotune, so only the real run is recorded */
+  if(recordPath){
+    if(!(tracefp = fopen(recordPath, "w"))){
+      perror("Error Opening Trace File");
+      return EXIT_FAILURE;
+    }
+    if(fileio_writer_open(&trace, tracefp) == FILEIO_FAILURE){
+      fprintf(stderr, "Error: Opening trace writer failed\n");
+      return EXIT_FAILURE;
+    }
+    recording = 1;
+  }
+
+  /* Load the previous results before the output file is opened, since the
+   * two may be the same file */
+  if(previousPath){
+    if(reportPath && !(reportfp = fopen(reportPath, "w"))){
+      perror("Error Opening Report File");
+      return EXIT_FAILURE;
+    }
+    if(inc_load(&index, previousPath, maxAge, reportfp) == UTIL_FAILURE)
+      return EXIT_FAILURE;
+    previous = &index;
+  }
+
+  /* Open Output File */
+  outputfp = fopen(argv[(argc-1)], "w");
+  if(!outputfp){
+    perror("Error Opening Output File\n");
+    return EXIT_FAILURE;
+  }
+
+  /* Ordered output goes through the shard table, even with one process */
+  if(processes || ordered){
+    elapsedTime = shard_run(&config, &argv[optind], inputCount, outputfp,
+                            processes ? processes : 1, ordered, stats);
+  }
+  else
+    elapsedTime = run_pipeline(&config, sources, inputCount, outputfp);
+
+  /* Report names that dropped out of the input and the run summary */
+  if(previous){
+    if(elapsedTime >= 0)
+      inc_finish(previous);
+    inc_free(previous);
+    if(reportfp)
+      fclose(reportfp);
+  }
+
+  if(overrides)
+    override_free(overrides);
+  if(replay)
+    replay_free(replay);
+  if(recording){
+    if(fileio_writer_close(&trace) == FILEIO_FAILURE)
+      elapsedTime = -1;
+    fclose(tracefp);
+  }
+
+  /* Close Output File */
+  fclose(outputfp);
+  if(elapsedTime < 0)
+    return EXIT_FAILURE;
 
-  /* Calculate the total elapsed and print the time (in microseconds) */
-  elapsedTime = endTime.tv_usec - startTime.tv_usec;
+  /* Print the total elapsed time (in microseconds) */
   printf("Elapsed time was: %ld\n", elapsedTime);
 
   return EXIT_SUCCESS;
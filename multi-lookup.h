@@ -11,21 +11,58 @@
 #include <sys/time.h>
 
 #include "util.h"
-#include "queue.h"
+#include "hostring.h"
 
 #define MINARGS 3
-#define USAGE "<inputFilePath> <outputFilePath>"
+#define USAGE \
+  "[options] <inputFilePath>[@priority[:weight]] ... <outputFilePath>"
 #define SBUFSIZE 1025
 #define INPUTFS "%1024s"
 
 #define MAX_INPUT_FILES 10
 #define MAX_RESOLVER_THREADS 10
+#define RESOLVER_THREAD_LIMIT 256 // Largest allowed max thread count
 #define MIN_RESOLVER_THREADS 2
 #define MAX_NAME_LENGTH 1025
 #define MAX_IP_LENGTH IENT6_ADDRSTRLEN
 #define QUEUE_SIZE 10
+#define MAX_QUEUE_SIZE 65536
+#define BATCH_SIZE 1
+#define MAX_BATCH_SIZE 64
 
-void* requester(void* fileName);
+/* Tuning profile written by --autotune and read at startup */
+#define PROFILE_PATH "multi-lookup.conf"
+
+/* Runtime pipeline parameters. Defaults come from the values above, then a
+ * saved profile, then command line flags, in that order of precedence */
+struct lookup_config{
+  int queueSize;          // Number of slots in the shared queue
+  int resolverThreads;    // Number of resolver threads to spawn
+  int maxResolverThreads; // Upper bound on resolverThreads
+  int batchSize;          // Names a resolver takes per queue lock
+  int policy;             // How resolvers choose between source lanes
+};
+
+struct shard_table;
+
+/* One input to the pipeline: a file, or one shard of a shared name table */
+struct lookup_source{
+  const char* path;           // Input file, or NULL when reading a shard
+  struct shard_table* table;  // Shared name table, or NULL when reading a file
+  int shard;                  // Shard of table to read
+  int priority;               // Higher is served first under strict policy
+  int weight;                 // Share of resolvers under weighted fair policy
+};
+
+void* requester(void* lane);
 void* resolver();
 
-#endif
\ No newline at end of file
+/* Runs the requester/resolver pipeline once with one requester per source.
+ * Results are written to outputfp, or stored back into the shard table when
+ * the sources are shards. Returns the elapsed time in microseconds, or -1 if
+ * the pipeline could not be set up */
+long run_pipeline(const struct lookup_config* config,
+                  struct lookup_source* sources, int sourceCount,
+                  FILE* outputfp);
+
+#endif
@@ -0,0 +1,452 @@
+/*
+ * File: override.c
+ * Author: Domenic Murtari
+ * Project: CSCI 3753 Programming Assignment 2
+ * Description: Hosts-style override table compiled into a minimal perfect
+ *  hash. A name's 64-bit hash picks its bucket from the high half; its slot
+ *  is the hash remixed with d, mod count, where d is its bucket's
+ *  displacement.
+ *  Buckets are placed largest first, trying displacements until every name
+ *  in the bucket lands in a free slot. If some bucket cannot be placed the
+ *  whole table is rebuilt with a new seed.
+ *
+ */
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "override.h"
+
+#define OVERRIDE_LINE_LENGTH 4096
+#define OVERRIDE_ALIGN 64
+#define OVERRIDE_ROUND(n) \
+  (((n) + OVERRIDE_ALIGN - 1) & ~(size_t)(OVERRIDE_ALIGN - 1))
+
+/* A name read from the hosts file, before it has a slot */
+struct override_entry{
+  size_t nameOffset;
+  const char* name;      // Set once the name pool stops moving, for sorting
+  size_t line;           // Earlier lines win for duplicate names
+  char ip[INET6_ADDRSTRLEN];
+};
+
+/*
+ * Seeded, case-insensitive FNV-1a with a final mix so both halves of the
+ * result are usable.
+ */
+static uint64_t override_hash(const char* name, uint32_t seed){
+
+  uint64_t hash = 14695981039346656037ULL ^ seed;
+
+  while(*name){
+    hash ^= (unsigned char)tolower((unsigned char)*name++);
+    hash *= 1099511628211ULL;
+  }
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ULL;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+static inline uint32_t override_bucket(uint64_t hash, uint32_t buckets){
+  return (uint32_t)(hash >> 32) % buckets;
+}
+
+static inline uint32_t override_slot_of(uint64_t hash, uint32_t d,
+                                        uint32_t count){
+
+  uint64_t x = hash ^ (d * 0x9e3779b97f4a7c15ULL);
+
+  x ^= x >> 32;
+  x *= 0xd6e8feb86659fd93ULL;
+  x ^= x >> 32;
+  return x % count;
+}
+
+const char* override_find(const struct override_table* table,
+                          const char* name){
+
+  const struct override_header* header = table->header;
+  const struct override_slot* slot;
+  uint64_t hash;
+
+  if(!header || header->count == 0)
+    return NULL;
+  hash = override_hash(name, header->seed);
+  slot = &table->slots[override_slot_of(hash, table->displacements[
+      override_bucket(hash, header->buckets)], header->count)];
+  /* A mapped image may be corrupt. Its last byte is a NUL, so a name that
+   * starts inside the pool ends inside the image */
+  if(slot->fingerprint != (uint32_t)hash ||
+     slot->nameOffset >= header->size - header->namesOffset ||
+     slot->ip[sizeof(slot->ip) - 1] != '\0' ||
+     strcasecmp(table->names + slot->nameOffset, name))
+    return NULL;
+  return slot->ip;
+}
+
+static int entry_compare(const void* a, const void* b){
+
+  const struct override_entry* x = a;
+  const struct override_entry* y = b;
+  int cmp = strcasecmp(x->name, y->name);
+
+  if(cmp)
+    return cmp;
+  return x->line < y->line ? -1 : x->line > y->line;
+}
+
+/*
+ * Finds a seed and displacements that give every entry its own slot.
+ * Returns UTIL_SUCCESS and fills slotOf, displacements and *seed, or
+ * UTIL_FAILURE.
+ */
+static int override_place(const struct override_entry* entries,
+                          const char* names, uint32_t count, uint32_t buckets,
+                          uint32_t* slotOf, uint32_t* displacements,
+                          uint32_t* seed){
+
+  uint64_t* hashes = malloc(count * sizeof(*hashes));
+  uint32_t* sizes = calloc(buckets, sizeof(*sizes));
+  uint32_t* starts = malloc((buckets + 1) * sizeof(*starts));
+  uint32_t* members = malloc(count * sizeof(*members));
+  uint32_t* order = malloc(buckets * sizeof(*order));
+  uint32_t* bySize = malloc((count + 1) * sizeof(*bySize));
+  char* taken = malloc(count);
+  uint32_t b, d, i, j, k, s, n;
+  int ret = UTIL_FAILURE;
+
+  if(!hashes || !sizes || !starts || !members || !order || !bySize ||
+     !taken){
+    perror("Error Building Override Table");
+    goto done;
+  }
+
+  for(*seed = 1; *seed <= OVERRIDE_MAX_SEEDS; (*seed)++){
+    /* Group entries by bucket */
+    memset(sizes, 0, buckets * sizeof(*sizes));
+    for(i = 0; i < count; i++){
+      hashes[i] = override_hash(names + entries[i].nameOffset, *seed);
+      sizes[override_bucket(hashes[i], buckets)]++;
+    }
+    starts[0] = 0;
+    for(b = 0; b < buckets; b++)
+      starts[b + 1] = starts[b] + sizes[b];
+    memset(order, 0, buckets * sizeof(*order));
+    for(i = 0; i < count; i++){
+      b = override_bucket(hashes[i], buckets);
+      members[starts[b] + order[b]++] = i;
+    }
+
+    /* Place the largest buckets first, while most slots are free. A
+     * counting sort on size, which keeps equal sized buckets in order */
+    memset(bySize, 0, (count + 1) * sizeof(*bySize));
+    for(b = 0; b < buckets; b++)
+      bySize[sizes[b]]++;
+    for(s = count + 1, i = 0; s-- > 0; i += n){
+      n = bySize[s];
+      bySize[s] = i;
+    }
+    for(b = 0; b < buckets; b++)
+      order[bySize[sizes[b]]++] = b;
+
+    memset(taken, 0, count);
+    memset(displacements, 0, buckets * sizeof(*displacements));
+    for(k = 0; k < buckets && sizes[order[k]]; k++){
+      b = order[k];
+      for(d = 0; d < OVERRIDE_MAX_DISPLACEMENT; d++){
+        for(j = 0; j < sizes[b]; j++){
+          i = members[starts[b] + j];
+          s = override_slot_of(hashes[i], d, count);
+          if(taken[s])
+            break;
+          taken[s] = 1;
+          slotOf[i] = s;
+        }
+        if(j == sizes[b])
+          break;
+        /* Give back the slots this displacement took */
+        while(j-- > 0)
+          taken[slotOf[members[starts[b] + j]]] = 0;
+      }
+      if(d == OVERRIDE_MAX_DISPLACEMENT)
+        break;
+      displacements[b] = d;
+    }
+    if(k == buckets || !sizes[order[k]]){
+      ret = UTIL_SUCCESS;
+      break;
+    }
+  }
+  if(ret == UTIL_FAILURE)
+    fprintf(stderr, "Error: no perfect hash found for the override table\n");
+
+ done:
+  free(hashes);
+  free(sizes);
+  free(starts);
+  free(members);
+  free(order);
+  free(bySize);
+  free(taken);
+  return ret;
+}
+
+/*
+ * Lays out the image for a set of unique entries.
+ */
+static int override_build(struct override_table* table,
+                          const struct override_entry* entries, uint32_t count,
+                          const char* names, size_t namesSize){
+
+  struct override_header* header;
+  struct override_slot* slots;
+  uint32_t* displacements;
+  uint32_t* slotOf = NULL;
+  uint32_t buckets = (count + OVERRIDE_BUCKET_LOAD - 1) / OVERRIDE_BUCKET_LOAD;
+  uint64_t slotsOffset;
+  uint64_t namesOffset;
+  uint64_t size;
+  uint32_t i;
+
+  if(buckets == 0)
+    buckets = 1;
+  slotsOffset = OVERRIDE_ROUND(sizeof(*header) +
+                               buckets * sizeof(*displacements));
+  namesOffset = slotsOffset + (uint64_t)count * sizeof(*slots);
+  size = OVERRIDE_ROUND(namesOffset + namesSize);
+
+  if(!(table->image = aligned_alloc(OVERRIDE_ALIGN, size)) ||
+     (count && !(slotOf = malloc(count * sizeof(*slotOf))))){
+    perror("Error Building Override Table");
+    return UTIL_FAILURE;
+  }
+  memset(table->image, 0, size);
+  table->imageSize = size;
+  header = table->image;
+  displacements = (uint32_t*)(header + 1);
+  slots = (struct override_slot*)((char*)table->image + slotsOffset);
+
+  memcpy(header->magic, OVERRIDE_MAGIC, sizeof(header->magic));
+  header->endian = OVERRIDE_ENDIAN;
+  header->count = count;
+  header->buckets = buckets;
+  header->slotsOffset = slotsOffset;
+  header->namesOffset = namesOffset;
+  header->size = size;
+
+  if(count && override_place(entries, names, count, buckets, slotOf,
+                             displacements, &header->seed) == UTIL_FAILURE){
+    free(slotOf);
+    return UTIL_FAILURE;
+  }
+  for(i = 0; i < count; i++){
+    slots[slotOf[i]].fingerprint =
+      (uint32_t)override_hash(names + entries[i].nameOffset, header->seed);
+    slots[slotOf[i]].nameOffset = entries[i].nameOffset;
+    strcpy(slots[slotOf[i]].ip, entries[i].ip);
+  }
+  memcpy((char*)table->image + namesOffset, names, namesSize);
+  free(slotOf);
+  return UTIL_SUCCESS;
+}
+
+/*
+ * Points the table at the sections of its image.
+ */
+static void override_attach(struct override_table* table){
+
+  table->header = table->image;
+  table->displacements = (const uint32_t*)(table->header + 1);
+  table->slots = (const struct override_slot*)
+    ((const char*)table->image + table->header->slotsOffset);
+  table->names = (const char*)table->image + table->header->namesOffset;
+}
+
+/*
+ * Maps a compiled image. Checks that the header fits the file and that the
+ * image ends in a NUL; slots are checked by override_find as they are used,
+ * so pages are only touched by lookups.
+ */
+static int override_map(struct override_table* table, const char* path,
+                        int fd){
+
+  const struct override_header* header;
+  struct stat st;
+
+  if(fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(*header)){
+    fprintf(stderr, "%s: truncated override image\n", path);
+    return UTIL_FAILURE;
+  }
+  table->image = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if(table->image == MAP_FAILED){
+    table->image = NULL;
+    perror("Error Mapping Override Image");
+    return UTIL_FAILURE;
+  }
+  table->imageSize = st.st_size;
+  table->mapped = 1;
+
+  header = table->image;
+  if(header->endian != OVERRIDE_ENDIAN || header->size != table->imageSize ||
+     header->buckets == 0 ||
+     header->slotsOffset < sizeof(*header) +
+       (uint64_t)header->buckets * sizeof(uint32_t) ||
+     header->namesOffset != header->slotsOffset +
+       (uint64_t)header->count * sizeof(struct override_slot) ||
+     header->namesOffset > header->size ||
+     ((const char*)table->image)[table->imageSize - 1] != '\0'){
+    fprintf(stderr, "%s: override image is corrupt or from another "
+            "machine\n", path);
+    return UTIL_FAILURE;
+  }
+  override_attach(table);
+  return UTIL_SUCCESS;
+}
+
+/*
+ * Reads a hosts-style file and builds the table from it.
+ */
+static int override_parse(struct override_table* table, const char* path,
+                          FILE* fp){
+
+  struct override_entry* entries = NULL;
+  struct in6_addr addr;
+  char line[OVERRIDE_LINE_LENGTH];
+  struct util_name_pool pool = {NULL, 0, 0};
+  char* ip;
+  char* name;
+  char* save;
+  size_t capacity = 0;
+  size_t count = 0;
+  size_t lineNumber = 0;
+  size_t i;
+  size_t j;
+  void* grown;
+  int ret = UTIL_FAILURE;
+
+  while(fgets(line, sizeof(line), fp)){
+    lineNumber++;
+    if(!strchr(line, '\n') && !feof(fp)){
+      fprintf(stderr, "%s:%zu: line too long\n", path, lineNumber);
+      goto done;
+    }
+    if((name = strchr(line, '#')))
+      *name = '\0';
+    if(!(ip = strtok_r(line, " \t\r\n", &save)))
+      continue;
+    if(strlen(ip) >= INET6_ADDRSTRLEN ||
+       (inet_pton(AF_INET, ip, &addr) != 1 &&
+        inet_pton(AF_INET6, ip, &addr) != 1)){
+      fprintf(stderr, "%s:%zu: invalid address %s\n", path, lineNumber, ip);
+      goto done;
+    }
+
+    /* Every name after the address maps to it */
+    while((name = strtok_r(NULL, " \t\r\n", &save))){
+      if(!(grown = util_array_grow(entries, &capacity, count,
+                                   sizeof(*entries), 256)))
+        goto nomem;
+      entries = grown;
+      if(util_name_pool_add(&pool, name, &entries[count].nameOffset)
+         == UTIL_FAILURE)
+        goto nomem;
+      entries[count].line = lineNumber;
+      strcpy(entries[count].ip, ip);
+      count++;
+    }
+  }
+  if(ferror(fp)){
+    perror("Error Reading Override File");
+    goto done;
+  }
+  if(count > UINT32_MAX / 2){
+    fprintf(stderr, "%s: too many names\n", path);
+    goto done;
+  }
+
+  /* Keep only the first address given for each name, as /etc/hosts does */
+  for(i = 0; i < count; i++)
+    entries[i].name = pool.names + entries[i].nameOffset;
+  qsort(entries, count, sizeof(*entries), entry_compare);
+  for(i = 0, j = 0; i < count; i++){
+    if(j > 0 && !strcasecmp(entries[j - 1].name, entries[i].name))
+      continue;
+    entries[j++] = entries[i];
+  }
+
+  ret = override_build(table, entries, j, pool.names, pool.used);
+  if(ret == UTIL_SUCCESS)
+    override_attach(table);
+  goto done;
+
+ nomem:
+  perror("Error Reading Override File");
+ done:
+  free(entries);
+  util_name_pool_free(&pool);
+  return ret;
+}
+
+int override_load(struct override_table* table, const char* path){
+
+  char magic[sizeof(((struct override_header*)0)->magic)];
+  FILE* fp;
+  int ret;
+
+  memset(table, 0, sizeof(*table));
+  if(!(fp = fopen(path, "r"))){
+    perror("Error Opening Override File");
+    return UTIL_FAILURE;
+  }
+
+  /* A compiled image starts with the magic string, NUL included */
+  if(fread(magic, 1, sizeof(magic), fp) == sizeof(magic) &&
+     !memcmp(magic, OVERRIDE_MAGIC, sizeof(magic)))
+    ret = override_map(table, path, fileno(fp));
+  else{
+    rewind(fp);
+    ret = override_parse(table, path, fp);
+  }
+  fclose(fp);
+
+  if(ret == UTIL_FAILURE)
+    override_free(table);
+  return ret;
+}
+
+int override_save(const struct override_table* table, const char* path){
+
+  FILE* fp;
+
+  if(!(fp = fopen(path, "w"))){
+    perror("Error Opening Override Image");
+    return UTIL_FAILURE;
+  }
+  if(fwrite(table->image, 1, table->imageSize, fp) != table->imageSize){
+    perror("Error Writing Override Image");
+    fclose(fp);
+    return UTIL_FAILURE;
+  }
+  if(fclose(fp)){
+    perror("Error Writing Override Image");
+    return UTIL_FAILURE;
+  }
+  return UTIL_SUCCESS;
+}
+
+void override_free(struct override_table* table){
+
+  if(table->image){
+    if(table->mapped)
+      munmap(table->image, table->imageSize);
+    else
+      free(table->image);
+  }
+  memset(table, 0, sizeof(*table));
+}
@@ -0,0 +1,79 @@
+/*
+ * File: override.h
+ * Author: Domenic Murtari
+ * Project: CSCI 3753 Programming Assignment 2
+ * Description: Declarations for the static override table. Names with known
+ *  addresses are listed in a hosts-style file:
+ *
+ *    # comment
+ *    10.0.0.5    build.internal  build
+ *
+ *  and answered from the table without a DNS lookup. At load time the names
+ *  are compiled into a minimal perfect hash (hash and displace): each name
+ *  hashes to a bucket, and each bucket stores the displacement that puts all
+ *  of its names into distinct slots, so a lookup is one hash, one bucket
+ *  read and one slot read. Slots are one cache line each and the whole table
+ *  is a single flat image, which can be written to a file and later mapped
+ *  straight into memory instead of rebuilt.
+ *
+ */
+
+#ifndef OVERRIDE_H
+#define OVERRIDE_H
+
+#include <stdint.h>
+
+#include "multi-lookup.h"
+
+#define OVERRIDE_MAGIC "MLOVRD1"
+#define OVERRIDE_ENDIAN 0x01020304u
+/* Average names per bucket */
+#define OVERRIDE_BUCKET_LOAD 4
+/* Displacements tried per bucket before starting over with a new seed */
+#define OVERRIDE_MAX_DISPLACEMENT (1u << 16)
+#define OVERRIDE_MAX_SEEDS 64
+
+/* Start of an image */
+struct override_header{
+  char magic[8];
+  uint32_t endian;       // OVERRIDE_ENDIAN in the byte order of the writer
+  uint32_t count;        // Names, and slots
+  uint32_t buckets;
+  uint32_t seed;
+  uint64_t slotsOffset;  // Offsets from the start of the image
+  uint64_t namesOffset;
+  uint64_t size;         // Bytes in the whole image
+};
+
+/* One name. The name itself is in the name pool */
+struct override_slot{
+  uint32_t fingerprint;  // Low bits of the name's hash, checked first
+  uint32_t nameOffset;
+  char ip[INET6_ADDRSTRLEN];
+} __attribute__((aligned(64)));
+
+struct override_table{
+  const struct override_header* header;
+  const uint32_t* displacements; // One per bucket
+  const struct override_slot* slots;
+  const char* names;
+  void* image;
+  size_t imageSize;
+  int mapped;                    // image is a file mapping, not malloc'd
+};
+
+/* Loads a hosts-style file, or maps a compiled image if path is one.
+ * Returns UTIL_SUCCESS or UTIL_FAILURE */
+int override_load(struct override_table* table, const char* path);
+
+/* Writes the table as an image that override_load can map. Returns
+ * UTIL_SUCCESS or UTIL_FAILURE */
+int override_save(const struct override_table* table, const char* path);
+
+/* Returns the address for name, or NULL if it has no override */
+const char* override_find(const struct override_table* table,
+                          const char* name);
+
+void override_free(struct override_table* table);
+
+#endif
@@ -0,0 +1,232 @@
+/*
+ * File: overrideTest.c
+ * Author: Domenic Murtari
+ * Project: CSCI 3753 Programming Assignment 2
+ * Description:
+ * 	This file contains test code for the override table. For
+ *      several table sizes it writes a hosts file, loads it, and
+ *      checks lookups of every name, of missing names and of
+ *      names in another case, that the first address wins for
+ *      a repeated name, and that a saved and mapped image gives
+ *      the same answers as the parsed table.
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <ctype.h>
+#include <unistd.h>
+
+#include "override.h"
+
+#define NAME_SIZE 64
+
+/* Table sizes to test, including ones with a single bucket */
+static const int tableSizes[] = {1, 2, 3, 50, 1000, 20000};
+#define SIZE_COUNT ((int)(sizeof(tableSizes) / sizeof(tableSizes[0])))
+
+static void name_of(char* name, int i){
+    snprintf(name, NAME_SIZE, "host%d.example.com", i);
+}
+
+static void alias_of(char* name, int i){
+    snprintf(name, NAME_SIZE, "alias%d", i);
+}
+
+static void ip_of(char* ip, int i){
+    if(i % 5 == 4){
+	snprintf(ip, INET6_ADDRSTRLEN, "fd00::%x", i);
+    }
+    else{
+	snprintf(ip, INET6_ADDRSTRLEN, "10.%d.%d.%d",
+		 (i >> 16) & 255, (i >> 8) & 255, i & 255);
+    }
+}
+
+/*
+ * Writes a hosts file with count names, every other one with an
+ * alias, then lines that repeat names with other addresses.
+ */
+static int write_hosts(const char* path, int count){
+
+    FILE* fp;
+    char name[NAME_SIZE];
+    char alias[NAME_SIZE];
+    char ip[INET6_ADDRSTRLEN];
+    int i;
+
+    if(!(fp = fopen(path, "w"))){
+	perror("error: writing hosts file");
+	return UTIL_FAILURE;
+    }
+    fprintf(fp, "# override test\n\n");
+    for(i = 0; i < count; i++){
+	name_of(name, i);
+	ip_of(ip, i);
+	if(i % 2){
+	    alias_of(alias, i);
+	    fprintf(fp, "%s\t%s %s  # comment\n", ip, name, alias);
+	}
+	else{
+	    fprintf(fp, "%s %s\n", ip, name);
+	}
+    }
+
+    /* Repeats, some in another case, which must lose */
+    for(i = 0; i < count; i += 3){
+	name_of(name, i);
+	if(i % 2){
+	    name[0] = toupper(name[0]);
+	}
+	fprintf(fp, "192.168.255.255 %s\n", name);
+    }
+    fclose(fp);
+    return UTIL_SUCCESS;
+}
+
+/*
+ * Checks every lookup against the addresses write_hosts used.
+ * Returns the number of failures.
+ */
+static int check_table(const char* label,
+		       const struct override_table* table, int count){
+
+    char name[NAME_SIZE];
+    char ip[INET6_ADDRSTRLEN];
+    const char* found;
+    int failures = 0;
+    int i;
+    int j;
+
+    for(i = 0; i < count; i++){
+	name_of(name, i);
+	ip_of(ip, i);
+	if(!(found = override_find(table, name)) || strcmp(found, ip)){
+	    fprintf(stderr,
+		    "error: %s: %s gave %s, expected %s\n",
+		    label, name, found ? found : "nothing", ip);
+	    failures++;
+	}
+
+	/* Same answer in upper case */
+	for(j = 0; name[j]; j++){
+	    name[j] = toupper(name[j]);
+	}
+	if(!(found = override_find(table, name)) || strcmp(found, ip)){
+	    fprintf(stderr,
+		    "error: %s: %s gave %s, expected %s\n",
+		    label, name, found ? found : "nothing", ip);
+	    failures++;
+	}
+
+	if(i % 2){
+	    alias_of(name, i);
+	    if(!(found = override_find(table, name)) ||
+	       strcmp(found, ip)){
+		fprintf(stderr,
+			"error: %s: alias %s gave %s, "
+			"expected %s\n", label, name,
+			found ? found : "nothing", ip);
+		failures++;
+	    }
+	}
+
+	/* Names that are not in the table */
+	snprintf(name, sizeof(name), "missing%d.example.com", i);
+	if((found = override_find(table, name))){
+	    fprintf(stderr,
+		    "error: %s: %s should miss, gave %s\n",
+		    label, name, found);
+	    failures++;
+	}
+	name_of(name, i + count);
+	if((found = override_find(table, name))){
+	    fprintf(stderr,
+		    "error: %s: %s should miss, gave %s\n",
+		    label, name, found);
+	    failures++;
+	}
+    }
+    if(override_find(table, "") || override_find(table, "host")){
+	fprintf(stderr,
+		"error: %s: prefix of a name should miss\n", label);
+	failures++;
+    }
+    return failures;
+}
+
+int main(int argc, char* argv[]){
+
+    /* Void Unused Variables */
+    (void) argc;
+    (void) argv;
+
+    /* Setup local vars */
+    char hostsPath[] = "/tmp/overrideTestXXXXXX";
+    char imagePath[] = "/tmp/overrideTestImgXXXXXX";
+    char label[64];
+    struct override_table parsed;
+    struct override_table mapped;
+    int fd;
+    int i;
+    int failures = 0;
+
+    if((fd = mkstemp(hostsPath)) < 0){
+	perror("error: creating hosts file");
+	return EXIT_FAILURE;
+    }
+    close(fd);
+    if((fd = mkstemp(imagePath)) < 0){
+	perror("error: creating image file");
+	unlink(hostsPath);
+	return EXIT_FAILURE;
+    }
+    close(fd);
+
+    for(i = 0; i < SIZE_COUNT; i++){
+	if(write_hosts(hostsPath, tableSizes[i]) == UTIL_FAILURE){
+	    failures++;
+	    break;
+	}
+
+	/* Parsed from the hosts file */
+	if(override_load(&parsed, hostsPath) == UTIL_FAILURE){
+	    fprintf(stderr,
+		    "error: loading %d names failed\n",
+		    tableSizes[i]);
+	    failures++;
+	    continue;
+	}
+	snprintf(label, sizeof(label), "parsed %d", tableSizes[i]);
+	failures += check_table(label, &parsed, tableSizes[i]);
+
+	/* Saved, then mapped back in */
+	if(override_save(&parsed, imagePath) == UTIL_FAILURE ||
+	   override_load(&mapped, imagePath) == UTIL_FAILURE){
+	    fprintf(stderr,
+		    "error: image of %d names failed\n",
+		    tableSizes[i]);
+	    failures++;
+	    override_free(&parsed);
+	    continue;
+	}
+	if(!mapped.mapped){
+	    fprintf(stderr,
+		    "error: image of %d names was not mapped\n",
+		    tableSizes[i]);
+	    failures++;
+	}
+	snprintf(label, sizeof(label), "mapped %d", tableSizes[i]);
+	failures += check_table(label, &mapped, tableSizes[i]);
+
+	override_free(&mapped);
+	override_free(&parsed);
+    }
+
+    unlink(hostsPath);
+    unlink(imagePath);
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
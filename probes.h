@@ -0,0 +1,93 @@
+/*
+ * File: probes.h
+ * Author: Domenic Murtari
+ * Project: CSCI 3753 Programming Assignment 2
+ * Description: Static tracepoints for the lookup pipeline, in the
+ *  "multilookup" provider. Build with "make USDT=1" (needs sys/sdt.h from
+ *  systemtap-sdt-dev) to compile them in; each probe is then a single nop
+ *  until a tracer such as bpftrace attaches. Without USDT=1 every probe
+ *  expands to nothing.
+ *
+ *  Probes and their arguments:
+ *    enqueue(hostname, depth)             requester added a name
+ *    dequeue(hostname, depth)             resolver took a name
+ *    lookup__start(hostname)              about to resolve a name
+ *    lookup__end(hostname, ip, ns, ok)    resolved a name, ok is 1 on success
+ *    cache__hit(hostname, ip)             answered without a DNS lookup
+ *    output__flush(bytes, ns)             an output block reached the file
+ *
+ *  Arguments that cost something to compute, like timestamps, are only
+ *  computed while a tracer is attached; use PROBE_ENABLED to check.
+ *
+ */
+
+#ifndef PROBES_H
+#define PROBES_H
+
+#ifdef HAVE_SYS_SDT
+
+/* Each probe gets a semaphore the tracer increments while it is attached */
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+#define PROBE_SEMAPHORE(name) multilookup_##name##_semaphore
+
+#define PROBE_SEMAPHORES(X) \
+  X(enqueue)                \
+  X(dequeue)                \
+  X(lookup__start)          \
+  X(lookup__end)            \
+  X(cache__hit)             \
+  X(output__flush)
+
+#define PROBE_DECLARE_SEMAPHORE(name) \
+  extern volatile unsigned short PROBE_SEMAPHORE(name);
+#define PROBE_DEFINE_SEMAPHORE(name)                                    \
+  volatile unsigned short PROBE_SEMAPHORE(name)                        \
+  __attribute__((unused, section(".probes"))) = 0;
+
+PROBE_SEMAPHORES(PROBE_DECLARE_SEMAPHORE)
+
+/* Goes in exactly one source file of the program */
+#define PROBE_DEFINE_SEMAPHORES PROBE_SEMAPHORES(PROBE_DEFINE_SEMAPHORE)
+
+#define PROBE_ENABLED(name) __builtin_expect(PROBE_SEMAPHORE(name) != 0, 0)
+
+#define PROBE_ENQUEUE(host, depth) \
+  DTRACE_PROBE2(multilookup, enqueue, host, depth)
+#define PROBE_DEQUEUE(host, depth) \
+  DTRACE_PROBE2(multilookup, dequeue, host, depth)
+#define PROBE_LOOKUP_START(host) \
+  DTRACE_PROBE1(multilookup, lookup__start, host)
+#define PROBE_LOOKUP_END(host, ip, ns, ok) \
+  DTRACE_PROBE4(multilookup, lookup__end, host, ip, ns, ok)
+#define PROBE_CACHE_HIT(host, ip) \
+  DTRACE_PROBE2(multilookup, cache__hit, host, ip)
+#define PROBE_OUTPUT_FLUSH(bytes, ns) \
+  DTRACE_PROBE2(multilookup, output__flush, bytes, ns)
+
+#else
+
+/* Arguments are referenced inside sizeof so they count as used but are never
+ * evaluated */
+#define PROBE_UNUSED(x) ((void)sizeof(x))
+
+#define PROBE_DEFINE_SEMAPHORES
+#define PROBE_ENABLED(name) 0
+#define PROBE_ENQUEUE(host, depth) \
+  do{ PROBE_UNUSED(host); PROBE_UNUSED(depth); }while(0)
+#define PROBE_DEQUEUE(host, depth) \
+  do{ PROBE_UNUSED(host); PROBE_UNUSED(depth); }while(0)
+#define PROBE_LOOKUP_START(host) \
+  do{ PROBE_UNUSED(host); }while(0)
+#define PROBE_LOOKUP_END(host, ip, ns, ok) \
+  do{ PROBE_UNUSED(host); PROBE_UNUSED(ip); PROBE_UNUSED(ns); \
+    PROBE_UNUSED(ok); }while(0)
+#define PROBE_CACHE_HIT(host, ip) \
+  do{ PROBE_UNUSED(host); PROBE_UNUSED(ip); }while(0)
+#define PROBE_OUTPUT_FLUSH(bytes, ns) \
+  do{ PROBE_UNUSED(bytes); PROBE_UNUSED(ns); }while(0)
+
+#endif
+
+#endif
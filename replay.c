@@ -0,0 +1,246 @@
+/*
+ * File: replay.c
+ * Author: Domenic Murtari
+ * Project: CSCI 3753 Programming Assignment 2
+ * Description: Loads a lookup trace into a hash table of names and answers
+ *  lookups from it. The table is read-only once loaded apart from each
+ *  name's answer counter, so resolvers share it without a lock.
+ *
+ */
+
+/* For EAI_NODATA, which glibc returns but only declares for GNU code */
+#define _GNU_SOURCE
+
+#include <limits.h>
+#include <math.h>
+#include <stddef.h>
+#include <time.h>
+
+#include "replay.h"
+
+/* Longest trace line: name, class, ip and latency */
+#define REPLAY_LINE_LENGTH (MAX_NAME_LENGTH + INET6_ADDRSTRLEN + 64)
+
+/* Status replayed for the "error" class, which covers every getaddrinfo
+ * error without a class of its own. Not a getaddrinfo code, so it is
+ * recorded as "error" again */
+#define REPLAY_ERROR INT_MIN
+
+/* Recorded classes of getaddrinfo errors */
+static const struct{
+  int status;
+  const char* name;
+} replayClasses[] = {
+  {0,          "ok"},
+  {EAI_NONAME, "nxdomain"},
+#ifdef EAI_NODATA
+  {EAI_NODATA, "nodata"},
+#endif
+  {EAI_AGAIN,  "timeout"},
+  {EAI_FAIL,   "servfail"},
+  {EAI_SYSTEM, "system"},
+  {REPLAY_ERROR, "error"}
+};
+
+#define REPLAY_CLASSES (sizeof(replayClasses) / sizeof(replayClasses[0]))
+
+/* A trace line before records are grouped by name */
+struct replay_line{
+  size_t nameOffset;
+  struct replay_group* group;
+  struct replay_record record;
+};
+
+const char* replay_class(int status){
+
+  size_t i;
+
+  for(i = 0; i < REPLAY_CLASSES; i++){
+    if(replayClasses[i].status == status)
+      return replayClasses[i].name;
+  }
+  return "error";
+}
+
+/*
+ * Looks up the status a class name is replayed as. Returns UTIL_FAILURE for
+ * an unknown class.
+ */
+static int replay_status(const char* name, int* status){
+
+  size_t i;
+
+  for(i = 0; i < REPLAY_CLASSES; i++){
+    if(!strcmp(replayClasses[i].name, name)){
+      *status = replayClasses[i].status;
+      return UTIL_SUCCESS;
+    }
+  }
+  return UTIL_FAILURE;
+}
+
+int replay_load(struct replay_trace* trace, const char* path, double scale){
+
+  FILE* tracefp;
+  struct replay_line* lines = NULL;
+  struct replay_group* group;
+  unsigned int* slot;
+  char line[REPLAY_LINE_LENGTH];
+  char name[MAX_NAME_LENGTH];
+  char class[32];
+  char ip[INET6_ADDRSTRLEN];
+  long long latency;
+  struct util_name_pool pool = {NULL, 0, 0};
+  size_t capacity = 0;
+  size_t count = 0;
+  size_t lineNumber = 0;
+  size_t len;
+  size_t i;
+  int status;
+  void* grown;
+
+  memset(trace, 0, sizeof(*trace));
+  if(!isfinite(scale) || scale < 0 || scale > MAX_REPLAY_SCALE){
+    fprintf(stderr, "Error: replay scale %g out of range\n", scale);
+    return UTIL_FAILURE;
+  }
+  trace->scale = scale;
+  if(!(tracefp = fopen(path, "r"))){
+    perror("Error Opening Trace File");
+    return UTIL_FAILURE;
+  }
+
+  while(fgets(line, sizeof(line), tracefp)){
+    lineNumber++;
+    if(sscanf(line, "%1024s %31s %45s %lld", name, class, ip,
+              &latency) != 4 || latency < 0){
+      fprintf(stderr, "%s:%zu: malformed trace line\n", path, lineNumber);
+      goto fail;
+    }
+    if(replay_status(class, &status) == UTIL_FAILURE){
+      fprintf(stderr, "%s:%zu: unknown class %s\n", path, lineNumber, class);
+      goto fail;
+    }
+
+    if(!(grown = util_array_grow(lines, &capacity, count, sizeof(*lines),
+                                 1024)))
+      goto nomem;
+    lines = grown;
+    if(util_name_pool_add(&pool, name, &lines[count].nameOffset)
+       == UTIL_FAILURE)
+      goto nomem;
+
+    lines[count].record.status = status;
+    lines[count].record.latencyNs = latency;
+    strcpy(lines[count].record.ip, strcmp(ip, "-") ? ip : "");
+    count++;
+  }
+  if(ferror(tracefp)){
+    perror("Error Reading Trace File");
+    goto fail;
+  }
+  fclose(tracefp);
+  tracefp = NULL;
+  trace->names = pool.names;
+  memset(&pool, 0, sizeof(pool));
+
+  /* Give each name a group and count its answers */
+  if(count && (!(trace->records = malloc(count * sizeof(*trace->records))) ||
+               !(trace->groups = malloc(count * sizeof(*trace->groups)))))
+    goto nomem;
+  if(util_name_table_init(&trace->table, count, trace->groups,
+                          sizeof(*trace->groups),
+                          offsetof(struct replay_group, name))
+     == UTIL_FAILURE)
+    goto nomem;
+  for(i = 0; i < count; i++){
+    slot = util_name_table_slot(&trace->table,
+                                trace->names + lines[i].nameOffset);
+    if(!*slot){
+      group = &trace->groups[trace->groupCount++];
+      group->name = trace->names + lines[i].nameOffset;
+      group->count = 0;
+      group->next = 0;
+      *slot = trace->groupCount;
+    }
+    lines[i].group = &trace->groups[*slot - 1];
+    lines[i].group->count++;
+  }
+
+  /* Lay the answers out group by group, in recorded order */
+  len = 0;
+  for(i = 0; i < trace->groupCount; i++){
+    trace->groups[i].first = len;
+    len += trace->groups[i].count;
+  }
+  for(i = 0; i < count; i++){
+    group = lines[i].group;
+    trace->records[group->first + group->next++] = lines[i].record;
+  }
+  for(i = 0; i < trace->groupCount; i++)
+    trace->groups[i].next = 0;
+
+  free(lines);
+  return UTIL_SUCCESS;
+
+ nomem:
+  perror("Error Loading Trace File");
+ fail:
+  if(tracefp)
+    fclose(tracefp);
+  free(lines);
+  util_name_pool_free(&pool);
+  replay_free(trace);
+  return UTIL_FAILURE;
+}
+
+int replay_lookup(struct replay_trace* trace, const char* hostname,
+                  char* firstIPstr, int maxSize, int* status){
+
+  const struct replay_record* record;
+  struct replay_group* group;
+  struct timespec wait;
+  unsigned int* slot = util_name_table_slot(&trace->table, hostname);
+  unsigned int n;
+  double scaled;
+  long long ns;
+
+  if(!*slot){
+    fprintf(stderr, "Error: no recorded answer for %s\n", hostname);
+    *status = EAI_NONAME;
+    return UTIL_FAILURE;
+  }
+  group = &trace->groups[*slot - 1];
+  n = __atomic_fetch_add(&group->next, 1, __ATOMIC_RELAXED);
+  record = &trace->records[group->first + n % group->count];
+
+  /* Take as long as the real lookup did. A huge recorded latency times the
+   * scale may not fit in a long long, so clamp before converting */
+  scaled = record->latencyNs * trace->scale;
+  ns = scaled >= (double)LLONG_MAX ? LLONG_MAX : (long long)scaled;
+  if(ns > 0){
+    wait.tv_sec = ns / 1000000000LL;
+    wait.tv_nsec = ns % 1000000000LL;
+    while(nanosleep(&wait, &wait) < 0 && errno == EINTR);
+  }
+
+  *status = record->status;
+  if(record->status){
+    fprintf(stderr, "Error looking up Address: %s\n",
+            record->status == REPLAY_ERROR ? "Unknown error" :
+            gai_strerror(record->status));
+    return UTIL_FAILURE;
+  }
+  strncpy(firstIPstr, record->ip, maxSize);
+  firstIPstr[maxSize - 1] = '\0';
+  return UTIL_SUCCESS;
+}
+
+void replay_free(struct replay_trace* trace){
+
+  free(trace->records);
+  free(trace->groups);
+  util_name_table_free(&trace->table);
+  free(trace->names);
+  memset(trace, 0, sizeof(*trace));
+}
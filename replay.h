@@ -0,0 +1,65 @@
+/*
+ * File: replay.h
+ * Author: Domenic Murtari
+ * Project: CSCI 3753 Programming Assignment 2
+ * Description: Declarations for lookup traces. A run with --record writes
+ *  one line per DNS lookup:
+ *
+ *    hostname class ip latency_ns
+ *
+ *  where class is ok, nxdomain, nodata, timeout, servfail, system or error,
+ *  and ip is "-" when the lookup failed. A run with --replay answers every
+ *  lookup from such a trace instead of DNS, waiting the recorded latency
+ *  times a scale factor, so pipeline changes can be compared on a captured
+ *  workload without a network.
+ *
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "multi-lookup.h"
+
+/* Largest --replay-scale */
+#define MAX_REPLAY_SCALE 1000.0
+
+struct replay_record{
+  int status;                 // getaddrinfo error code, 0 on success
+  char ip[INET6_ADDRSTRLEN];
+  long long latencyNs;
+};
+
+/* Every recorded answer for one name. A name looked up several times gets
+ * its answers back in recorded order, then starts over */
+struct replay_group{
+  const char* name;
+  size_t first;               // Index of the first record
+  unsigned int count;
+  unsigned int next;          // Answers handed out so far
+};
+
+struct replay_trace{
+  struct replay_record* records;
+  struct replay_group* groups;
+  size_t groupCount;
+  struct util_name_table table; // Names to groups
+  char* names;                // Pool of NUL terminated names
+  double scale;               // Multiplier for recorded latencies
+};
+
+/* Name of the class a getaddrinfo error code is recorded as */
+const char* replay_class(int status);
+
+/* Loads a trace. scale must be between 0 and MAX_REPLAY_SCALE. Returns
+ * UTIL_SUCCESS or UTIL_FAILURE */
+int replay_load(struct replay_trace* trace, const char* path, double scale);
+
+/* Stands in for dnslookup_status: waits the scaled recorded latency and
+ * returns the recorded answer. A name missing from the trace fails as
+ * EAI_NONAME */
+int replay_lookup(struct replay_trace* trace, const char* hostname,
+                  char* firstIPstr, int maxSize, int* status);
+
+void replay_free(struct replay_trace* trace);
+
+#endif
@@ -0,0 +1,182 @@
+/*
+ * File: ring.h
+ * Author: Domenic Murtari
+ * Project: CSCI 3753 Programming Assignment 2
+ * Description:
+ *  Macro templates for a FIFO ring of strings that stores each string
+ *  inline in a fixed, cache-line-aligned slot. Strings too long for a slot
+ *  are copied to the heap and the slot keeps a pointer to them. Push copies
+ *  the string in and pop copies it out, so a consumer reads one slot of one
+ *  contiguous array instead of chasing a pointer to another thread's
+ *  allocation. Each slot also carries an unsigned tag that the ring passes
+ *  through untouched.
+ *
+ *  RING_DECLARE(name, slotSize) goes in a header and RING_DEFINE(name,
+ *  slotSize) in one source file. slotSize must be a multiple of
+ *  RING_CACHE_LINE. The generated functions mirror queue.h:
+ *
+ *    int  name_init(name* q, int size);
+ *    int  name_is_empty(name* q);
+ *    int  name_is_full(name* q);
+ *    int  name_push(name* q, const char* str, size_t len, unsigned tag);
+ *    int  name_pop(name* q, char* str, size_t size, unsigned* tag);
+ *    void name_cleanup(name* q);
+ *
+ */
+
+#ifndef RING_H
+#define RING_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RING_CACHE_LINE 64
+
+#define RING_FAILURE -1
+#define RING_SUCCESS 0
+
+/* Bytes of a slot left for the string after the length and tag */
+#define RING_INLINE_SIZE(slotSize) ((slotSize) - 8)
+
+#define RING_DECLARE(name, slotSize)                                        \
+                                                                            \
+typedef struct name##_slot_s{                                               \
+    unsigned int len;                                                       \
+    unsigned int tag;                                                       \
+    union{                                                                  \
+	char text[RING_INLINE_SIZE(slotSize)];                              \
+	char* overflow;                                                     \
+    } data;                                                                 \
+} __attribute__((aligned(RING_CACHE_LINE))) name##_slot;                    \
+                                                                            \
+_Static_assert(sizeof(name##_slot) == (slotSize),                           \
+	       #name " slot size must be a multiple of RING_CACHE_LINE");   \
+                                                                            \
+typedef struct name##_s{                                                    \
+    name##_slot* array;                                                     \
+    int front;                                                              \
+    int rear;                                                               \
+    int count;                                                              \
+    int maxSize;                                                            \
+} name;                                                                     \
+                                                                            \
+/* Function to initilze a new ring                                          \
+ * On success, returns ring size                                            \
+ * On failure, returns RING_FAILURE                                         \
+ * Must be called before ring is used                                       \
+ */                                                                         \
+int name##_init(name* q, int size);                                         \
+                                                                            \
+/* Function to test if ring is empty                                        \
+ * Returns 1 if empty, 0 otherwise                                          \
+ */                                                                         \
+int name##_is_empty(name* q);                                               \
+                                                                            \
+/* Function to test if ring is full                                         \
+ * Returns 1 if full, 0 otherwise                                           \
+ */                                                                         \
+int name##_is_full(name* q);                                                \
+                                                                            \
+/* Function to copy len bytes of str and its tag to the end of the ring     \
+ * Returns RING_SUCCESS if the push succeeds.                               \
+ * Returns RING_FAILURE if the ring is full or memory runs out              \
+ */                                                                         \
+int name##_push(name* q, const char* str, size_t len, unsigned tag);        \
+                                                                            \
+/* Function to copy the oldest string out of the ring into str, truncated  \
+ * to size-1 characters and NUL terminated, and its tag into *tag if set    \
+ * Returns the stored length, or RING_FAILURE if the ring is empty          \
+ */                                                                         \
+int name##_pop(name* q, char* str, size_t size, unsigned* tag);             \
+                                                                            \
+/* Function to free ring memory */                                          \
+void name##_cleanup(name* q);
+
+#define RING_DEFINE(name, slotSize)                                         \
+                                                                            \
+int name##_init(name* q, int size){                                         \
+    if(size <= 0){                                                          \
+	return RING_FAILURE;                                                \
+    }                                                                       \
+    q->maxSize = size;                                                      \
+    q->array = aligned_alloc(RING_CACHE_LINE, sizeof(name##_slot) * size);  \
+    if(!(q->array)){                                                        \
+	perror("Error on ring Malloc");                                     \
+	return RING_FAILURE;                                                \
+    }                                                                       \
+    q->front = 0;                                                           \
+    q->rear = 0;                                                            \
+    q->count = 0;                                                           \
+    return q->maxSize;                                                      \
+}                                                                           \
+                                                                            \
+int name##_is_empty(name* q){                                               \
+    return q->count == 0;                                                   \
+}                                                                           \
+                                                                            \
+int name##_is_full(name* q){                                                \
+    return q->count == q->maxSize;                                          \
+}                                                                           \
+                                                                            \
+int name##_push(name* q, const char* str, size_t len, unsigned tag){        \
+    name##_slot* slot;                                                      \
+    char* dest;                                                             \
+    if(name##_is_full(q)){                                                  \
+	return RING_FAILURE;                                                \
+    }                                                                       \
+    slot = &q->array[q->rear];                                              \
+    if(len < sizeof(slot->data.text)){                                      \
+	dest = slot->data.text;                                             \
+    }                                                                       \
+    else{                                                                   \
+	if(!(dest = malloc(len + 1))){                                      \
+	    return RING_FAILURE;                                            \
+	}                                                                   \
+	slot->data.overflow = dest;                                         \
+    }                                                                       \
+    memcpy(dest, str, len);                                                 \
+    dest[len] = '\0';                                                       \
+    slot->len = len;                                                        \
+    slot->tag = tag;                                                        \
+    q->rear = (q->rear + 1) % q->maxSize;                                   \
+    q->count++;                                                             \
+    return RING_SUCCESS;                                                    \
+}                                                                           \
+                                                                            \
+int name##_pop(name* q, char* str, size_t size, unsigned* tag){             \
+    name##_slot* slot;                                                      \
+    const char* src;                                                        \
+    size_t n;                                                               \
+    int len;                                                                \
+    if(name##_is_empty(q)){                                                 \
+	return RING_FAILURE;                                                \
+    }                                                                       \
+    slot = &q->array[q->front];                                             \
+    len = slot->len;                                                        \
+    src = slot->len < sizeof(slot->data.text) ?                             \
+	slot->data.text : slot->data.overflow;                              \
+    if(str && size > 0){                                                    \
+	n = slot->len < size ? slot->len : size - 1;                        \
+	memcpy(str, src, n);                                                \
+	str[n] = '\0';                                                      \
+    }                                                                       \
+    if(tag){                                                                \
+	*tag = slot->tag;                                                   \
+    }                                                                       \
+    if(src != slot->data.text){                                             \
+	free(slot->data.overflow);                                          \
+    }                                                                       \
+    q->front = (q->front + 1) % q->maxSize;                                 \
+    q->count--;                                                             \
+    return len;                                                             \
+}                                                                           \
+                                                                            \
+void name##_cleanup(name* q){                                               \
+    while(!name##_is_empty(q)){                                             \
+	name##_pop(q, NULL, 0, NULL);                                       \
+    }                                                                       \
+    free(q->array);                                                         \
+}
+
+#endif
@@ -0,0 +1,164 @@
+/*
+ * File: ringTest.c
+ * Author: Domenic Murtari
+ * Project: CSCI 3753 Programming Assignment 2
+ * Description:
+ * 	This file contains test code for the inline-slot
+ *      hostname ring.
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include "hostring.h"
+
+#define TEST_SIZE 10
+#define LONG_NAME_LENGTH 300
+
+int main(int argc, char* argv[]){
+
+    /* Void Unused Variables */
+    (void) argc;
+    (void) argv;
+
+    /* Setup local vars */
+    hostring q;
+    int i;
+    int len;
+    unsigned tag;
+    int failures = 0;
+    const int qSize = TEST_SIZE;
+    char payload_in[TEST_SIZE][LONG_NAME_LENGTH + 1];
+    char payload_out[LONG_NAME_LENGTH + 1];
+    char small_out[8];
+
+    /* Setup payload_in as hostnames; every third one is too
+     * long to fit inline and goes to the overflow path */
+    for(i=0; i<TEST_SIZE; i++){
+	if(i % 3 == 0){
+	    memset(payload_in[i], 'a' + i, LONG_NAME_LENGTH);
+	    payload_in[i][LONG_NAME_LENGTH] = '\0';
+	}
+	else{
+	    snprintf(payload_in[i], sizeof(payload_in[i]),
+		     "host%d.example.com", i);
+	}
+    }
+
+    /* Check the slot layout */
+    if(sizeof(hostring_slot) != RING_CACHE_LINE){
+	fprintf(stderr,
+		"error: hostring slot is %zu bytes, "
+		"expected %d\n",
+		sizeof(hostring_slot), RING_CACHE_LINE);
+	failures++;
+    }
+
+    /* Initialize Ring */
+    if(hostring_init(&q, qSize) == RING_FAILURE){
+	fprintf(stderr,
+		"error: hostring_init failed!\n");
+	return EXIT_FAILURE;
+    }
+    if(((size_t)q.array) % RING_CACHE_LINE){
+	fprintf(stderr,
+		"error: ring array is not "
+		"cache line aligned\n");
+	failures++;
+    }
+
+    /* Test for empty ring when empty */
+    if(!hostring_is_empty(&q) || hostring_is_full(&q)){
+	fprintf(stderr,
+		"error: ring should report empty\n");
+	failures++;
+    }
+
+    /* Test ring push */
+    for(i=0; i<TEST_SIZE; i++){
+	if(hostring_push(&q, payload_in[i], strlen(payload_in[i]), i)
+	   == RING_FAILURE){
+	    fprintf(stderr,
+		    "error: hostring_push failed!\n"
+		    "Payload Index: %d\n", i);
+	    failures++;
+	}
+    }
+
+    /* Test for full ring when full */
+    if(hostring_is_empty(&q) || !hostring_is_full(&q)){
+	fprintf(stderr,
+		"error: ring should report full\n");
+	failures++;
+    }
+
+    /* Test that push fails when full */
+    if(hostring_push(&q, payload_in[1], strlen(payload_in[1]), 1)
+       != RING_FAILURE){
+	fprintf(stderr,
+		"error: hostring_push did not fail"
+		" when full!\n");
+	failures++;
+    }
+
+    /* Test ring pop and compare */
+    for(i=0; i<TEST_SIZE; i++){
+	len = hostring_pop(&q, payload_out, sizeof(payload_out), &tag);
+	if(len != (int)strlen(payload_in[i]) ||
+	   strcmp(payload_in[i], payload_out) || tag != (unsigned)i){
+	    fprintf(stderr,
+		    "error: push/pop mismatch!\n"
+		    "Payload Index: %d, "
+		    "Input Value: %s, "
+		    "Output Value: %s, "
+		    "Output Tag: %u\n",
+		    i, payload_in[i], payload_out, tag);
+	    failures++;
+	}
+    }
+
+    /* Test for empty ring when empty */
+    if(!hostring_is_empty(&q) || hostring_is_full(&q)){
+	fprintf(stderr,
+		"error: ring should report empty\n");
+	failures++;
+    }
+
+    /* Test that pop fails when empty */
+    if(hostring_pop(&q, payload_out, sizeof(payload_out), &tag)
+       != RING_FAILURE){
+	fprintf(stderr,
+		"error: hostring_pop did not fail"
+		" when empty!\n");
+	failures++;
+    }
+
+    /* Test that pop truncates to the buffer but reports
+     * the full length */
+    hostring_push(&q, payload_in[2], strlen(payload_in[2]), 2);
+    len = hostring_pop(&q, small_out, sizeof(small_out), NULL);
+    if(len != (int)strlen(payload_in[2]) ||
+       strncmp(small_out, payload_in[2], sizeof(small_out) - 1) ||
+       small_out[sizeof(small_out) - 1] != '\0'){
+	fprintf(stderr,
+		"error: hostring_pop did not truncate"
+		" correctly\n");
+	failures++;
+    }
+
+    /* Test wrap around with overflow names left in the
+     * ring for cleanup to free */
+    for(i=0; i<TEST_SIZE; i++){
+	hostring_push(&q, payload_in[i], strlen(payload_in[i]), i);
+	hostring_pop(&q, payload_out, sizeof(payload_out), NULL);
+	hostring_push(&q, payload_in[0], strlen(payload_in[0]), 0);
+    }
+
+    /* Cleanup Ring */
+    hostring_cleanup(&q);
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
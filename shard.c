@@ -0,0 +1,280 @@
+/*
+ * File: shard.c
+ * Author: Domenic Murtari
+ * Project: CSCI 3753 Programming Assignment 2
+ * Description: Runs the lookup pipeline across several worker processes.
+ *  Each process has its own resolver state and stdio locks, so throughput
+ *  is no longer capped by what one process can do. A worker that dies is
+ *  detected through waitpid() and its shard is rerun; names the dead worker
+ *  already stored are not looked up again.
+ *
+ */
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "shard.h"
+#include "fileio.h"
+
+void shard_store(struct shard_table* table, size_t index, const char* ip){
+
+  struct shard_entry* entry = &table->entries[index];
+
+  strncpy(entry->ip, ip, sizeof(entry->ip));
+  entry->ip[sizeof(entry->ip) - 1] = '\0';
+  __atomic_store_n(&entry->done, 1, __ATOMIC_RELEASE);
+}
+
+int shard_table_load(struct shard_table* table, char** inputFiles,
+                     int inputCount, int shards, fileio_decode_stats* decoded){
+
+  fileio_reader input;
+  char hostname[MAX_NAME_LENGTH];
+  char errorstr[SBUFSIZE];
+  size_t* offsets = NULL;
+  struct util_name_pool pool = {NULL, 0, 0};
+  size_t count = 0;
+  size_t capacity = 0;
+  void* grown;
+  size_t i;
+  int ret = 0;
+  int f;
+
+  memset(table, 0, sizeof(*table));
+  if(decoded)
+    memset(decoded, 0, inputCount * sizeof(*decoded));
+
+  /* Collect all names into private buffers first to learn the total size */
+  for(f = 0; f < inputCount; f++){
+    if(fileio_reader_open(&input, inputFiles[f]) == FILEIO_FAILURE){
+      snprintf(errorstr, sizeof(errorstr), "Error Opening Input File: %s",
+               inputFiles[f]);
+      perror(errorstr);
+      continue;
+    }
+    while((ret = fileio_read_name(&input, hostname, sizeof(hostname))) > 0){
+      if(!(grown = util_array_grow(offsets, &capacity, count,
+                                   sizeof(*offsets), 1024)))
+        goto nomem;
+      offsets = grown;
+      if(util_name_pool_add(&pool, hostname, &offsets[count]) == UTIL_FAILURE)
+        goto nomem;
+      count++;
+    }
+    if(ret < 0){
+      snprintf(errorstr, sizeof(errorstr), "Error Reading Input File: %s",
+               inputFiles[f]);
+      perror(errorstr);
+    }
+    fileio_reader_close(&input);
+    if(decoded)
+      decoded[f] = input.decoded;
+  }
+
+  /* Move the names into memory the worker processes will share */
+  table->count = count;
+  table->shards = shards;
+  table->mapSize = count * sizeof(struct shard_entry) + pool.used;
+  if(table->mapSize == 0)
+    table->mapSize = 1;
+  table->map = mmap(NULL, table->mapSize, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if(table->map == MAP_FAILED){
+    perror("Error Mapping Shard Table");
+    table->map = NULL;
+    free(offsets);
+    util_name_pool_free(&pool);
+    return UTIL_FAILURE;
+  }
+  table->entries = table->map;
+  table->names = (char*)(table->entries + count);
+  memcpy(table->names, pool.names, pool.used);
+  for(i = 0; i < count; i++){
+    table->entries[i].nameOffset = offsets[i];
+    table->entries[i].shard = util_hash(table->names + offsets[i]) % shards;
+  }
+
+  free(offsets);
+  util_name_pool_free(&pool);
+  return UTIL_SUCCESS;
+
+ nomem:
+  perror("Error Loading Shard Table");
+  fileio_reader_close(&input);
+  free(offsets);
+  util_name_pool_free(&pool);
+  return UTIL_FAILURE;
+}
+
+void shard_table_free(struct shard_table* table){
+
+  if(table->map)
+    munmap(table->map, table->mapSize);
+  memset(table, 0, sizeof(*table));
+}
+
+/*
+ * Starts a worker process for one shard. Returns its pid, or -1 on failure.
+ */
+static pid_t shard_spawn(const struct lookup_config* config,
+                         struct shard_table* table, int shard){
+
+  struct lookup_source source;
+  pid_t pid;
+
+  fflush(stdout);
+  fflush(stderr);
+  pid = fork();
+  if(pid != 0)
+    return pid;
+
+  /* Worker: run the pipeline over this shard only */
+  source.path = NULL;
+  source.table = table;
+  source.shard = shard;
+  source.priority = 0;
+  source.weight = 1;
+  exit(run_pipeline(config, &source, 1, NULL) < 0 ? EXIT_FAILURE
+       : EXIT_SUCCESS);
+}
+
+/*
+ * Writes one result line for each name in the given shard (or every name if
+ * shard is -1), in input order.
+ */
+static void shard_write(struct shard_table* table, fileio_writer* writer,
+                        int shard){
+
+  char line[MAX_NAME_LENGTH + INET6_ADDRSTRLEN + 2];
+  size_t i;
+
+  for(i = 0; i < table->count; i++){
+    if(shard >= 0 && table->entries[i].shard != (unsigned)shard)
+      continue;
+    fileio_write(writer, line, snprintf(line, sizeof(line), "%s,%s\n",
+                                        shard_name(table, i),
+                                        table->entries[i].ip));
+  }
+}
+
+long shard_run(const struct lookup_config* config, char** inputFiles,
+               int inputCount, FILE* outputfp, int processes, int ordered,
+               int stats){
+
+  struct shard_table table;
+  fileio_writer writer;
+  fileio_decode_stats decoded[inputCount];
+  int header = 0;
+  pid_t workers[processes];
+  int retries[processes];
+  int running = 0;
+  int failed = 0;
+  int status;
+  pid_t pid;
+  int shard;
+  size_t i;
+  int f;
+
+  /* Variables to keep track of execution time */
+  struct timeval startTime;
+  struct timeval endTime;
+
+  gettimeofday(&startTime, NULL);
+
+  if(shard_table_load(&table, inputFiles, inputCount, processes, decoded)
+     == UTIL_FAILURE)
+    return -1;
+
+  /* Start one worker per shard */
+  for(shard = 0; shard < processes; shard++){
+    retries[shard] = 0;
+    if((workers[shard] = shard_spawn(config, &table, shard)) < 0){
+      perror("Error Forking Shard Worker");
+      failed = 1;
+      continue;
+    }
+    running++;
+  }
+
+  /* Wait for the workers, rerunning any shard whose worker died */
+  while(running > 0){
+    pid = wait(&status);
+    if(pid < 0){
+      if(errno == EINTR)
+        continue;
+      perror("Error Waiting For Shard Worker");
+      failed = 1;
+      break;
+    }
+    for(shard = 0; shard < processes && workers[shard] != pid; shard++);
+    if(shard == processes)
+      continue;
+    running--;
+    workers[shard] = 0;
+    if(WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS)
+      continue;
+
+    if(WIFSIGNALED(status)){
+      fprintf(stderr, "Shard %d worker %d killed by signal %d\n", shard,
+              (int)pid, WTERMSIG(status));
+    }
+    else{
+      fprintf(stderr, "Shard %d worker %d exited with status %d\n", shard,
+              (int)pid, WEXITSTATUS(status));
+    }
+    if(retries[shard]++ >= SHARD_RETRIES){
+      fprintf(stderr, "Shard %d failed %d times, giving up\n", shard,
+              retries[shard]);
+      failed = 1;
+      continue;
+    }
+    if((workers[shard] = shard_spawn(config, &table, shard)) < 0){
+      perror("Error Forking Shard Worker");
+      failed = 1;
+      continue;
+    }
+    fprintf(stderr, "Shard %d retry %d in worker %d\n", shard,
+            retries[shard], (int)workers[shard]);
+    running++;
+  }
+
+  /* Anything left over after a failed shard is reported as unresolved */
+  for(i = 0; i < table.count; i++){
+    if(!shard_is_done(&table, i)){
+      fprintf(stderr, "dnslookup error: %s (shard %u did not finish)\n",
+              shard_name(&table, i), table.entries[i].shard);
+      shard_store(&table, i, "");
+    }
+  }
+
+  /* Merge the shard results into the output file */
+  if(fileio_writer_open(&writer, outputfp) == FILEIO_FAILURE){
+    shard_table_free(&table);
+    return -1;
+  }
+  if(ordered){
+    shard_write(&table, &writer, -1);
+  }
+  else{
+    for(shard = 0; shard < processes; shard++)
+      shard_write(&table, &writer, shard);
+  }
+  if(fileio_writer_close(&writer) == FILEIO_FAILURE)
+    failed = 1;
+
+  shard_table_free(&table);
+  gettimeofday(&endTime, NULL);
+
+  /* Workers only see the shared table, so the parent, which did the
+   * decompressing, reports it */
+  if(stats){
+    for(f = 0; f < inputCount; f++)
+      fileio_decode_report(stderr, "Input", f, &decoded[f], inputFiles[f],
+                           &header);
+  }
+
+  if(failed)
+    return -1;
+  return (endTime.tv_sec - startTime.tv_sec) * 1000000L +
+    (endTime.tv_usec - startTime.tv_usec);
+}
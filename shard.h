@@ -0,0 +1,71 @@
+/*
+ * File: shard.h
+ * Author: Domenic Murtari
+ * Project: CSCI 3753 Programming Assignment 2
+ * Description: Declarations for running the pipeline in several worker
+ *  processes. The parent reads every hostname into a table in shared memory
+ *  and assigns each one to a shard by hash. Each worker process runs the
+ *  usual requester/resolver pipeline over one shard and stores its results
+ *  back into the table, which the parent then writes out.
+ *
+ */
+
+#ifndef SHARD_H
+#define SHARD_H
+
+#include "multi-lookup.h"
+#include "fileio.h"
+
+/* Times a shard is rerun after its worker crashes */
+#define SHARD_RETRIES 2
+/* Upper bound on worker processes */
+#define MAX_PROCESSES 64
+
+/* One input hostname in the shared table */
+struct shard_entry{
+  unsigned int nameOffset;     // Offset of the name in the name pool
+  unsigned int shard;          // Shard the name hashes to
+  int done;                    // Set once ip holds the result
+  char ip[INET6_ADDRSTRLEN];   // Result, empty if the lookup failed
+};
+
+struct shard_table{
+  struct shard_entry* entries; // Names in input order
+  char* names;                 // Pool of NUL terminated names
+  size_t count;
+  int shards;
+  void* map;                   // Shared mapping holding entries and names
+  size_t mapSize;
+};
+
+static inline const char* shard_name(const struct shard_table* table,
+                                     size_t index){
+  return table->names + table->entries[index].nameOffset;
+}
+
+static inline int shard_is_done(const struct shard_table* table,
+                                size_t index){
+  return __atomic_load_n(&table->entries[index].done, __ATOMIC_ACQUIRE);
+}
+
+/* Records the result for one name. Called from worker processes */
+void shard_store(struct shard_table* table, size_t index, const char* ip);
+
+/* Reads every input file into a new shared table split into the given number
+ * of shards. If decoded is not NULL it gets the decompression totals of each
+ * input. Returns UTIL_SUCCESS or UTIL_FAILURE */
+int shard_table_load(struct shard_table* table, char** inputFiles,
+                     int inputCount, int shards, fileio_decode_stats* decoded);
+
+void shard_table_free(struct shard_table* table);
+
+/* Resolves the input files with one worker process per shard and writes the
+ * results to outputfp, in input order if ordered is set and shard by shard
+ * otherwise. With stats set, prints the decompression totals of compressed
+ * inputs after the merge. Returns the elapsed time in microseconds, or -1 on
+ * failure */
+long shard_run(const struct lookup_config* config, char** inputFiles,
+               int inputCount, FILE* outputfp, int processes, int ordered,
+               int stats);
+
+#endif
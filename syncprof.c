@@ -0,0 +1,165 @@
+/*
+ * File: syncprof.c
+ * Author: Domenic Murtari
+ * Project: CSCI 3753 Programming Assignment 2
+ * Description: Initialization, teardown and reporting for the named mutex
+ *  and semaphore wrappers in syncprof.h.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "syncprof.h"
+
+#ifdef SYNC_PROFILE
+
+/* Most distinct names the table can hold */
+#define SYNC_MAX_NAMES 32
+
+static sync_stats totals[SYNC_MAX_NAMES];
+static int totalCount = 0;
+static pthread_mutex_t totalsMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t reportOnce = PTHREAD_ONCE_INIT;
+static const char* reportLabel = NULL;
+
+static void sync_report_at_exit(void){
+  sync_report(stderr);
+}
+
+static void sync_register_report(void){
+  atexit(sync_report_at_exit);
+}
+
+static void sync_stats_init(sync_stats* stats, const char* name, int isMutex){
+
+  memset(stats, 0, sizeof(*stats));
+  stats->name = name;
+  stats->isMutex = isMutex;
+  pthread_once(&reportOnce, sync_register_report);
+}
+
+/*
+ * Adds one primitive's counts to the totals for its name.
+ */
+static void sync_stats_fold(const sync_stats* stats){
+
+  sync_stats* total = NULL;
+  int i;
+
+  pthread_mutex_lock(&totalsMutex);
+  for(i = 0; i < totalCount; i++){
+    if(!strcmp(totals[i].name, stats->name)){
+      total = &totals[i];
+      break;
+    }
+  }
+  if(!total && totalCount < SYNC_MAX_NAMES){
+    total = &totals[totalCount++];
+    total->name = stats->name;
+    total->isMutex = stats->isMutex;
+  }
+  if(total){
+    total->acquisitions += stats->acquisitions;
+    total->contended += stats->contended;
+    total->waitNs += stats->waitNs;
+    total->holdNs += stats->holdNs;
+    if(stats->maxWaitNs > total->maxWaitNs)
+      total->maxWaitNs = stats->maxWaitNs;
+    if(stats->maxHoldNs > total->maxHoldNs)
+      total->maxHoldNs = stats->maxHoldNs;
+  }
+  pthread_mutex_unlock(&totalsMutex);
+}
+
+int sync_mutex_init(sync_mutex* m, const char* name){
+  sync_stats_init(&m->stats, name, 1);
+  return pthread_mutex_init(&m->m, NULL);
+}
+
+int sync_sem_init(sync_sem* s, const char* name, unsigned int value){
+  sync_stats_init(&s->stats, name, 0);
+  return sem_init(&s->s, 0, value);
+}
+
+int sync_mutex_destroy(sync_mutex* m){
+  sync_stats_fold(&m->stats);
+  return pthread_mutex_destroy(&m->m);
+}
+
+int sync_sem_destroy(sync_sem* s){
+  sync_stats_fold(&s->stats);
+  return sem_destroy(&s->s);
+}
+
+void sync_reset(const char* label){
+
+  pthread_mutex_lock(&totalsMutex);
+  memset(totals, 0, sizeof(totals));
+  totalCount = 0;
+  reportLabel = label;
+  pthread_mutex_unlock(&totalsMutex);
+}
+
+void sync_report(FILE* fp){
+
+  const sync_stats* t;
+  int i;
+
+  pthread_mutex_lock(&totalsMutex);
+  if(totalCount == 0){
+    pthread_mutex_unlock(&totalsMutex);
+    return;
+  }
+
+  if(reportLabel)
+    fprintf(fp, "\nContention (pid %d, %s)\n", (int)getpid(), reportLabel);
+  else
+    fprintf(fp, "\nContention (pid %d)\n", (int)getpid());
+  fprintf(fp, "%-16s %12s %12s %6s %12s %10s %12s %10s\n", "name",
+          "acquired", "contended", "cont%", "wait ms", "max us", "hold ms",
+          "max us");
+  for(i = 0; i < totalCount; i++){
+    t = &totals[i];
+    fprintf(fp, "%-16s %12llu %12llu %5.1f%% %12.3f %10.1f ", t->name,
+            t->acquisitions, t->contended,
+            t->acquisitions ? 100.0 * t->contended / t->acquisitions : 0.0,
+            t->waitNs / 1e6, t->maxWaitNs / 1e3);
+    if(t->isMutex)
+      fprintf(fp, "%12.3f %10.1f\n", t->holdNs / 1e6, t->maxHoldNs / 1e3);
+    else
+      fprintf(fp, "%12s %10s\n", "-", "-");
+  }
+  pthread_mutex_unlock(&totalsMutex);
+}
+
+#else
+
+int sync_mutex_init(sync_mutex* m, const char* name){
+  (void)name;
+  return pthread_mutex_init(&m->m, NULL);
+}
+
+int sync_sem_init(sync_sem* s, const char* name, unsigned int value){
+  (void)name;
+  return sem_init(&s->s, 0, value);
+}
+
+int sync_mutex_destroy(sync_mutex* m){
+  return pthread_mutex_destroy(&m->m);
+}
+
+int sync_sem_destroy(sync_sem* s){
+  return sem_destroy(&s->s);
+}
+
+void sync_reset(const char* label){
+  (void)label;
+}
+
+void sync_report(FILE* fp){
+  (void)fp;
+}
+
+#endif
@@ -0,0 +1,175 @@
+/*
+ * File: syncprof.h
+ * Author: Domenic Murtari
+ * Project: CSCI 3753 Programming Assignment 2
+ * Description: Named mutex and semaphore wrappers for the pipeline. In a
+ *  normal build they are plain pthread mutexes and POSIX semaphores. Built
+ *  with "make SYNC_PROFILE=1", every wrapper records how often it was taken,
+ *  how often a thread had to wait for it, how long those waits were and, for
+ *  mutexes, how long it was held. The totals for each name are printed as a
+ *  contention table when the program exits.
+ *
+ */
+
+#ifndef SYNCPROF_H
+#define SYNCPROF_H
+
+#include <stdio.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+#ifdef SYNC_PROFILE
+
+#include <errno.h>
+
+#include "util.h"
+
+typedef struct sync_stats_s{
+  const char* name;
+  int isMutex;
+  unsigned long long acquisitions; // Successful locks or waits
+  unsigned long long contended;    // Acquisitions that had to block
+  unsigned long long waitNs;       // Total time spent blocked
+  unsigned long long maxWaitNs;
+  unsigned long long holdNs;       // Total time held (mutexes only)
+  unsigned long long maxHoldNs;
+} sync_stats;
+
+typedef struct sync_mutex_s{
+  pthread_mutex_t m;
+  sync_stats stats;
+  long long acquiredAt;            // When the current holder got the lock
+} sync_mutex;
+
+typedef struct sync_sem_s{
+  sem_t s;
+  sync_stats stats;
+} sync_sem;
+
+/* Atomically raises *max to value */
+static inline void sync_max(unsigned long long* max, unsigned long long value){
+
+  unsigned long long old = __atomic_load_n(max, __ATOMIC_RELAXED);
+
+  while(value > old &&
+        !__atomic_compare_exchange_n(max, &old, value, 1, __ATOMIC_RELAXED,
+                                     __ATOMIC_RELAXED));
+}
+
+static inline void sync_mutex_lock(sync_mutex* m){
+
+  long long start;
+  long long wait;
+
+  /* Only time the acquisition if the lock is actually busy */
+  if(pthread_mutex_trylock(&m->m) == 0){
+    m->acquiredAt = util_now_ns();
+    m->stats.acquisitions++;
+    return;
+  }
+  start = util_now_ns();
+  pthread_mutex_lock(&m->m);
+  m->acquiredAt = util_now_ns();
+  wait = m->acquiredAt - start;
+
+  /* The lock is held, so the counters need no atomics */
+  m->stats.acquisitions++;
+  m->stats.contended++;
+  m->stats.waitNs += wait;
+  if((unsigned long long)wait > m->stats.maxWaitNs)
+    m->stats.maxWaitNs = wait;
+}
+
+static inline void sync_mutex_unlock(sync_mutex* m){
+
+  unsigned long long held = util_now_ns() - m->acquiredAt;
+
+  m->stats.holdNs += held;
+  if(held > m->stats.maxHoldNs)
+    m->stats.maxHoldNs = held;
+  pthread_mutex_unlock(&m->m);
+}
+
+static inline int sync_sem_wait(sync_sem* s){
+
+  long long start;
+  unsigned long long wait;
+  int ret;
+
+  if(sem_trywait(&s->s) == 0){
+    __atomic_add_fetch(&s->stats.acquisitions, 1, __ATOMIC_RELAXED);
+    return 0;
+  }
+  start = util_now_ns();
+  while((ret = sem_wait(&s->s)) < 0 && errno == EINTR);
+  wait = util_now_ns() - start;
+
+  /* Semaphores have no exclusive holder, so update with atomics */
+  __atomic_add_fetch(&s->stats.acquisitions, 1, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&s->stats.contended, 1, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&s->stats.waitNs, wait, __ATOMIC_RELAXED);
+  sync_max(&s->stats.maxWaitNs, wait);
+  return ret;
+}
+
+static inline int sync_sem_trywait(sync_sem* s){
+
+  if(sem_trywait(&s->s) < 0)
+    return -1;
+  __atomic_add_fetch(&s->stats.acquisitions, 1, __ATOMIC_RELAXED);
+  return 0;
+}
+
+#else
+
+typedef struct sync_mutex_s{
+  pthread_mutex_t m;
+} sync_mutex;
+
+typedef struct sync_sem_s{
+  sem_t s;
+} sync_sem;
+
+static inline void sync_mutex_lock(sync_mutex* m){
+  pthread_mutex_lock(&m->m);
+}
+
+static inline void sync_mutex_unlock(sync_mutex* m){
+  pthread_mutex_unlock(&m->m);
+}
+
+static inline int sync_sem_wait(sync_sem* s){
+  return sem_wait(&s->s);
+}
+
+static inline int sync_sem_trywait(sync_sem* s){
+  return sem_trywait(&s->s);
+}
+
+#endif
+
+static inline int sync_sem_post(sync_sem* s){
+  return sem_post(&s->s);
+}
+
+/* Initializes a mutex or semaphore under the given name. The name must stay
+ * valid until the program exits. Returns 0 on success like pthread_mutex_init
+ * and sem_init */
+int sync_mutex_init(sync_mutex* m, const char* name);
+int sync_sem_init(sync_sem* s, const char* name, unsigned int value);
+
+/* Destroys a mutex or semaphore. When profiling, its counts are added to the
+ * totals for its name, so a name reused across runs is reported once */
+int sync_mutex_destroy(sync_mutex* m);
+int sync_sem_destroy(sync_sem* s);
+
+/* Drops the totals collected so far, so the report only covers what is
+ * destroyed from now on, and adds label to the report heading. label must
+ * stay valid until the program exits */
+void sync_reset(const char* label);
+
+/* Prints the contention table for everything destroyed so far. Does nothing
+ * unless built with SYNC_PROFILE */
+void sync_report(FILE* fp);
+
+#endif
@@ -10,9 +10,20 @@
  *  
  */
 
+#include <limits.h>
+#include <stdint.h>
+
 #include "util.h"
 
+/* First size of a name pool */
+#define UTIL_POOL_SIZE (64 * 1024)
+
 int dnslookup(const char* hostname, char* firstIPstr, int maxSize){
+    return dnslookup_status(hostname, firstIPstr, maxSize, NULL);
+}
+
+int dnslookup_status(const char* hostname, char* firstIPstr, int maxSize,
+		     int* status){
 
     /* Local vars */
     struct addrinfo* headresult = NULL;
@@ -30,6 +41,9 @@ int dnslookup(const char* hostname, char* firstIPstr, int maxSize){
    
     /* Lookup Hostname */
     addrError = getaddrinfo(hostname, NULL, NULL, &headresult);
+    if(status){
+	*status = addrError;
+    }
     if(addrError){
 	fprintf(stderr, "Error looking up Address: %s\n",
 		gai_strerror(addrError));
@@ -45,6 +59,9 @@ int dnslookup(const char* hostname, char* firstIPstr, int maxSize){
 	    if(!inet_ntop(result->ai_family, ipv4addr,
 			  ipv4str, sizeof(ipv4str))){
 		perror("Error Converting IP to String");
+		if(status){
+		    *status = EAI_SYSTEM;
+		}
 		return UTIL_FAILURE;
 	    }
 #ifdef UTIL_DEBUG
@@ -81,3 +98,114 @@ int dnslookup(const char* hostname, char* firstIPstr, int maxSize){
 
     return UTIL_SUCCESS;
 }
+
+unsigned int util_hash(const char* str){
+
+    unsigned int hash = 2166136261u;
+
+    while(*str){
+	hash ^= (unsigned char)*str++;
+	hash *= 16777619u;
+    }
+    return hash;
+}
+
+int util_name_table_init(struct util_name_table* table, size_t count,
+			 const void* entries, size_t stride,
+			 size_t nameOffset){
+
+    size_t size;
+
+    /* Power of two at least twice the entry count */
+    for(size = 1; size < count * 2; size <<= 1);
+    table->slots = calloc(size, sizeof(*table->slots));
+    if(!table->slots){
+	return UTIL_FAILURE;
+    }
+    table->mask = size - 1;
+    table->entries = entries;
+    table->stride = stride;
+    table->nameOffset = nameOffset;
+    return UTIL_SUCCESS;
+}
+
+/* Name of the entry a non-empty slot refers to */
+static const char* util_name_of(const struct util_name_table* table,
+				unsigned int slot){
+    return *(const char* const*)(table->entries +
+				 (slot - 1) * table->stride +
+				 table->nameOffset);
+}
+
+unsigned int* util_name_table_slot(const struct util_name_table* table,
+				   const char* name){
+
+    size_t i = util_hash(name) & table->mask;
+
+    while(table->slots[i] &&
+	  strcmp(util_name_of(table, table->slots[i]), name)){
+	i = (i + 1) & table->mask;
+    }
+    return &table->slots[i];
+}
+
+void util_name_table_free(struct util_name_table* table){
+
+    free(table->slots);
+    table->slots = NULL;
+    table->mask = 0;
+}
+
+void* util_array_grow(void* array, size_t* capacity, size_t count,
+		      size_t size, size_t initial){
+
+    size_t grown;
+
+    if(count < *capacity){
+	return array;
+    }
+    grown = *capacity ? *capacity * 2 : initial;
+    if(grown > SIZE_MAX / size){
+	errno = ENOMEM;
+	return NULL;
+    }
+    if(!(array = realloc(array, grown * size))){
+	return NULL;
+    }
+    *capacity = grown;
+    return array;
+}
+
+int util_name_pool_add(struct util_name_pool* pool, const char* name,
+		       size_t* offset){
+
+    size_t len = strlen(name) + 1;
+    size_t size;
+    char* grown;
+
+    if(pool->used + len > UINT_MAX){
+	errno = EOVERFLOW;
+	return UTIL_FAILURE;
+    }
+    if(pool->used + len > pool->size){
+	for(size = pool->size ? pool->size * 2 : UTIL_POOL_SIZE;
+	    size < pool->used + len; size *= 2);
+	if(!(grown = realloc(pool->names, size))){
+	    return UTIL_FAILURE;
+	}
+	pool->names = grown;
+	pool->size = size;
+    }
+    memcpy(pool->names + pool->used, name, len);
+    *offset = pool->used;
+    pool->used += len;
+    return UTIL_SUCCESS;
+}
+
+void util_name_pool_free(struct util_name_pool* pool){
+
+    free(pool->names);
+    pool->names = NULL;
+    pool->used = 0;
+    pool->size = 0;
+}
@@ -20,6 +20,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
+#include <time.h>
 
 #include <arpa/inet.h>
 #include <sys/types.h>
@@ -29,6 +30,29 @@
 #define UTIL_FAILURE -1
 #define UTIL_SUCCESS 0
 
+/* Open addressing hash table from names to positions
+ * in an array of entries. Each entry holds a pointer
+ * to its name at nameOffset. Slots hold the entry's
+ * index + 1, or 0 when empty
+ */
+struct util_name_table{
+    unsigned int* slots;
+    size_t mask;
+    const char* entries;
+    size_t stride;
+    size_t nameOffset;
+};
+
+/* Names stored back to back, each NUL terminated and
+ * found by its offset, so the pool can move as it grows.
+ * Offsets always fit in an unsigned int
+ */
+struct util_name_pool{
+    char* names;
+    size_t used;
+    size_t size;
+};
+
 /* Fuction to return the first IP address found
  * for hostname. IP address returned as string
  * firstIPstr of size maxsize
@@ -37,4 +61,68 @@ int dnslookup(const char* hostname,
 	      char* firstIPstr,
 	      int maxSize);
 
+/* Same as dnslookup, and also stores the getaddrinfo
+ * error code (0 on success) in status if it is set
+ */
+int dnslookup_status(const char* hostname,
+		     char* firstIPstr,
+		     int maxSize,
+		     int* status);
+
+/* FNV-1a hash of a string
+ */
+unsigned int util_hash(const char* str);
+
+/* Sets up an empty table for up to count entries of
+ * the given size, kept no more than half full.
+ * Returns UTIL_SUCCESS or UTIL_FAILURE
+ */
+int util_name_table_init(struct util_name_table* table,
+			 size_t count,
+			 const void* entries,
+			 size_t stride,
+			 size_t nameOffset);
+
+/* Returns the slot that holds name, or the empty slot
+ * where it belongs
+ */
+unsigned int* util_name_table_slot(const struct util_name_table* table,
+				   const char* name);
+
+void util_name_table_free(struct util_name_table* table);
+
+/* Makes room for element count of an array of elements
+ * of the given size, doubling *capacity (starting from
+ * initial) when it is full. Returns the array, which may
+ * have moved, or NULL if out of memory, leaving the old
+ * array as it was
+ */
+void* util_array_grow(void* array,
+		      size_t* capacity,
+		      size_t count,
+		      size_t size,
+		      size_t initial);
+
+/* Copies name to the end of the pool and stores its
+ * offset. Returns UTIL_SUCCESS, or UTIL_FAILURE with
+ * errno set if out of memory or the pool would pass
+ * UINT_MAX bytes
+ */
+int util_name_pool_add(struct util_name_pool* pool,
+		       const char* name,
+		       size_t* offset);
+
+void util_name_pool_free(struct util_name_pool* pool);
+
+/* Monotonic time in nanoseconds, for measuring
+ * intervals
+ */
+static inline long long util_now_ns(void){
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
 #endif